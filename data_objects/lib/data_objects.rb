@@ -3,12 +3,18 @@ require 'data_objects/utilities'
 require 'data_objects/logger'
 require 'data_objects/byte_array'
 require 'data_objects/pooling'
+require 'data_objects/pooling/global_limit'
+require 'data_objects/pooling/auto_sizer'
+require 'data_objects/concurrency_limiter'
 require 'data_objects/connection'
 require 'data_objects/uri'
 require 'data_objects/transaction'
 require 'data_objects/command'
 require 'data_objects/result'
 require 'data_objects/reader'
+require 'data_objects/pooling/multiplexed_connection'
+require 'data_objects/replica_set'
+require 'data_objects/shard_router'
 require 'data_objects/quoting'
 require 'data_objects/extension'
 require 'data_objects/error'
@@ -18,3 +24,4 @@ require 'data_objects/error/data_error'
 require 'data_objects/error/integrity_error'
 require 'data_objects/error/syntax_error'
 require 'data_objects/error/transaction_error'
+require 'data_objects/error/query_timeout_error'
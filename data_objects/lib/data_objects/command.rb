@@ -21,6 +21,27 @@ module DataObjects
       raise NotImplementedError.new
     end
 
+    # Send this command without waiting for it to finish. Pick up its
+    # DataObjects::Reader with Connection#get_result.
+    def send_reader(*args)
+      raise NotImplementedError.new
+    end
+
+    # Send this command without waiting for it to finish. Pick up its
+    # DataObjects::Result with Connection#get_result.
+    def send_non_query(*args)
+      raise NotImplementedError.new
+    end
+
+    # Seconds this command may run before it's cancelled on the server, and
+    # a DataObjects::QueryTimeoutError is raised. Without one, the
+    # query_timeout of the connection applies.
+    attr_writer :timeout
+
+    def timeout
+      @timeout || connection.query_timeout
+    end
+
     # Assign an array of types for the columns to be returned by this command
     def set_types(column_types)
       raise NotImplementedError.new
@@ -0,0 +1,133 @@
+require 'thread'
+
+module DataObjects
+
+  # ==== Notes
+  # Limits the number of queries in flight against one database, and adapts
+  # that limit to how the database is doing. Every query that finishes
+  # within the latency target raises the limit by 1/limit, so it grows by
+  # about one per round of queries. A slower query, or a lost connection,
+  # multiplies the limit by the backoff factor. During a brownout excess
+  # queries are rejected (or queued for a while) instead of piling up on
+  # an already struggling server.
+  #
+  # Options:
+  # initial_limit::  Limit to start with (10)
+  # min_limit::      The limit never drops below this (1)
+  # max_limit::      The limit never grows beyond this (64)
+  # latency_target:: Queries slower than this many seconds shrink the limit (0.1)
+  # backoff::        Factor the limit is multiplied by on a slow query (0.9)
+  # queue_timeout::  Seconds a query waits for room before it's rejected (0)
+  class ConcurrencyLimiter
+
+    # Raised for a query there was no room for within the queue timeout.
+    class LimitExceededError < StandardError
+    end
+
+    # Wraps execute_reader and execute_non_query of a driver's Command class,
+    # so they go through the limiter of the connection's pool, if it has one.
+    def self.install(command)
+      return if command.method_defined?(:execute_reader_without_limiter)
+
+      command.class_eval do
+        alias execute_reader_without_limiter execute_reader
+        alias execute_non_query_without_limiter execute_non_query
+
+        def execute_reader(*args)
+          DataObjects::ConcurrencyLimiter.around(@connection) { execute_reader_without_limiter(*args) }
+        end
+
+        def execute_non_query(*args)
+          DataObjects::ConcurrencyLimiter.around(@connection) { execute_non_query_without_limiter(*args) }
+        end
+      end
+    end
+
+    def self.around(connection)
+      pool    = connection.instance_variable_get(:@__pool)
+      limiter = pool && pool.concurrency_limiter
+      limiter ? limiter.run { yield } : yield
+    end
+
+    attr_reader :rejections, :latency
+
+    def initialize(options = {})
+      @min_limit     = options[:min_limit] || 1
+      @max_limit     = options[:max_limit] || 64
+      @limit         = [[options[:initial_limit] || 10, @min_limit].max, @max_limit].min.to_f
+      @target        = options[:latency_target] || 0.1
+      @backoff       = options[:backoff] || 0.9
+      @queue_timeout = options[:queue_timeout] || 0
+
+      @in_flight  = 0
+      @rejections = 0
+      @latency    = nil
+      @lock       = Mutex.new
+      @room       = ConditionVariable.new
+    end
+
+    # The number of queries currently allowed in flight.
+    def limit
+      @limit.floor
+    end
+
+    def in_flight
+      @in_flight
+    end
+
+    def stats
+      @lock.synchronize do
+        { :limit => limit, :in_flight => @in_flight, :rejections => @rejections, :latency => @latency }
+      end
+    end
+
+    def run
+      acquire
+      started = Time.now
+      dropped = false
+      begin
+        yield
+      rescue DataObjects::ConnectionError
+        dropped = true
+        raise
+      ensure
+        release(dropped ? nil : Time.now - started)
+      end
+    end
+
+    private
+
+    def acquire
+      @lock.synchronize do
+        deadline = Time.now + @queue_timeout
+        while @in_flight >= limit
+          remaining = deadline - Time.now
+          if remaining <= 0
+            @rejections += 1
+            raise LimitExceededError.new("#{@in_flight} queries in flight, the limit is #{limit}")
+          end
+          @room.wait(@lock, remaining)
+        end
+        @in_flight += 1
+      end
+    end
+
+    # +latency+ is nil for a query that lost its connection.
+    def release(latency)
+      @lock.synchronize do
+        @in_flight -= 1
+
+        if latency.nil? || latency > @target
+          @limit = [@limit * @backoff, @min_limit].max
+        else
+          @limit = [@limit + 1 / @limit, @max_limit].min
+        end
+        @latency = latency && (@latency ? @latency * 0.8 + latency * 0.2 : latency)
+
+        @room.signal
+      end
+    end
+
+  end
+
+end
@@ -9,9 +9,191 @@ module DataObjects
 
     include Logging
 
+    # The resolved form of a connection URI: the driver's Connection class
+    # and the URI to pass on to it. Specs are frozen and cached by URI
+    # string, so Connection.new doesn't parse the URI or look up the driver
+    # every time.
+    class Spec
+      attr_reader :driver_class, :uri
+
+      def initialize(driver_class, uri)
+        @driver_class = driver_class
+        @uri          = uri.frozen? ? uri : uri.dup.freeze
+        @pooled       = driver_class.include?(Pooling)
+        freeze
+      end
+
+      def pooled?
+        @pooled
+      end
+
+      # The pool isn't kept, as the scavenger disposes of pools that ran
+      # empty. Looking it up is cheap with a frozen URI.
+      def pool
+        @driver_class.__pool(@uri) if @pooled
+      end
+
+      # Applies the block to the pool, and again whenever the pool is
+      # created anew after the scavenger disposed of it. Returns the result
+      # of the block.
+      def configure_pool(name, &block)
+        @driver_class.__configure_pool(name, @uri, &block) if @pooled
+      end
+
+      def connect(priority = nil)
+        if priority && @pooled
+          pool.new(priority)
+        else
+          @driver_class.new(@uri)
+        end
+      end
+    end
+
+    MAX_SPECS = 1000
+
+    @specs     = {}
+    @spec_lock = Mutex.new
+
     # Make a connection to the database using the DataObjects::URI given.
     # Note that the physical connection may be delayed until the first command is issued, so success here doesn't necessarily mean you can connect.
-    def self.new(uri_s)
+    # Pass :priority => :batch for background work, which may only use part of the pool, see DataObjects::Pooling::Pool.
+    # With :multiplex => true a pooled connection is only checked out while a statement or transaction runs, see DataObjects::Pooling::MultiplexedConnection.
+    # Within DataObjects.with_connection the connection checked out first is returned every time, and closing it does nothing.
+    def self.new(uri_s, options = {})
+      spec = spec(uri_s)
+      if options[:multiplex] && spec.pooled?
+        Pooling::MultiplexedConnection.new(spec, options[:priority])
+      elsif spec.pooled? && (scope = Thread.current[:__data_objects_sticky]) && (sticky = scope[spec.uri.to_s])
+        sticky.checkout(spec, options[:priority])
+      else
+        spec.connect(options[:priority])
+      end
+    end
+
+    # A connection held by the current thread for the duration of a
+    # DataObjects.with_connection block. It's checked out on first use only.
+    class Sticky
+      attr_reader :connection
+
+      def initialize
+        @depth      = 0
+        @connection = nil
+      end
+
+      def enter
+        @depth += 1
+      end
+
+      # Returns true once the outermost block is left.
+      def leave
+        (@depth -= 1) == 0
+      end
+
+      def checkout(spec, priority)
+        # A connection that got detached from its pool can't be kept
+        if @connection.nil? || @connection.instance_variable_get(:@__pool).nil?
+          @connection = spec.connect(priority)
+          @connection.instance_variable_set(:@__sticky, true)
+        end
+        @connection
+      end
+
+      def release
+        return if @connection.nil?
+
+        connection, @connection = @connection, nil
+        connection.instance_variable_set(:@__sticky, false)
+        connection.release
+      end
+    end
+
+    # Starts a DataObjects.with_connection scope for the URI in the current
+    # thread. Scopes for the same URI nest.
+    def self.enter_sticky(uri_s)
+      scope = Thread.current[:__data_objects_sticky] ||= {}
+      (scope[spec(uri_s).uri.to_s] ||= Sticky.new).enter
+    end
+
+    # Ends a scope started by enter_sticky, releasing its connection when
+    # it was the outermost one.
+    def self.leave_sticky(uri_s)
+      return unless scope = Thread.current[:__data_objects_sticky]
+
+      key = spec(uri_s).uri.to_s
+      return unless (sticky = scope[key]) && sticky.leave
+
+      scope.delete(key)
+      Thread.current[:__data_objects_sticky] = nil if scope.empty?
+      sticky.release
+    end
+
+    # Returns the Spec for a URI. Specs for URI strings are cached.
+    def self.spec(uri_s)
+      return resolve(uri_s) unless String === uri_s
+
+      @specs[uri_s] || @spec_lock.synchronize do
+        @specs.clear if @specs.size >= MAX_SPECS
+        @specs[uri_s] ||= resolve(uri_s)
+      end
+    end
+
+    # Opens +count+ connections to the given URI in parallel, so the first
+    # requests don't have to wait for them. Pass an Array of SQL statements
+    # as :prepare to run them on every new connection of the pool, warming
+    # up the caches of the database for the first real queries. With
+    # :after_fork, forked children open their own +count+ connections again.
+    def self.prewarm(uri_s, count, options = {})
+      spec = spec(uri_s)
+      return 0 unless spec.pooled?
+
+      if statements = options[:prepare]
+        spec.configure_pool(:prepare) do |pool|
+          pool.on_create(:prepare) do |connection|
+            statements.each { |sql| connection.create_command(sql).execute_reader.close }
+          end
+        end
+      end
+      spec.configure_pool(:prewarm_after_fork) { |pool| pool.prewarm_after_fork = count } if options[:after_fork]
+      spec.pool.prewarm(count)
+    end
+
+    # Caps the number of connections to the given URI across all processes
+    # on this host to +max+, see DataObjects::Pooling::GlobalLimit. Call it
+    # before forking workers. The slot files are created in Dir.tmpdir,
+    # unless a :directory is given.
+    def self.global_limit(uri_s, max, options = {})
+      spec = spec(uri_s)
+      return nil unless spec.pooled?
+
+      limit = Pooling::GlobalLimit.new(spec.uri, max, options[:directory] || Dir.tmpdir)
+      spec.configure_pool(:global_limit) { |pool| pool.global_limit = limit }
+    end
+
+    # Puts an adaptive limit on the number of queries in flight against the
+    # given URI, see DataObjects::ConcurrencyLimiter for the options. Returns
+    # the limiter, which reports its current limit and rejections.
+    def self.concurrency_limit(uri_s, options = {})
+      spec = spec(uri_s)
+      return nil unless spec.pooled?
+
+      ConcurrencyLimiter.install(DataObjects::const_get(spec.driver_class.name.split('::')[-2]).const_get('Command'))
+      limiter = ConcurrencyLimiter.new(options)
+      spec.configure_pool(:concurrency_limiter) { |pool| pool.concurrency_limiter = limiter }
+    end
+
+    # Lets the size of the pool for the given URI follow the load, see
+    # DataObjects::Pooling::AutoSizer for the options. Returns the sizer,
+    # which keeps its recent decisions.
+    def self.auto_size(uri_s, options = {})
+      spec = spec(uri_s)
+      return nil unless spec.pooled?
+
+      sizer = Pooling::AutoSizer.new(options)
+      spec.configure_pool(:auto_sizer) { |pool| pool.auto_sizer = sizer }
+    end
+
+    # Parses the URI and looks up its driver, returning a new Spec.
+    def self.resolve(uri_s)
       uri = DataObjects::URI::parse(uri_s)
 
       case uri.scheme.to_sym
@@ -65,7 +247,7 @@ module DataObjects
           end
         end
       end
-      clazz.new(conn_uri)
+      Spec.new(clazz, conn_uri)
     end
 
     # Ensure that all Connection subclasses handle pooling and logging uniformly.
@@ -117,6 +299,26 @@ module DataObjects
       raise NotImplementedError.new
     end
 
+    # Seconds a command on this connection may run, see Command#timeout.
+    # Defaults to the query_timeout option of the URI, nil for no limit.
+    attr_writer :query_timeout
+
+    def query_timeout
+      return @query_timeout if @query_timeout
+      query = @uri.query if @uri.respond_to?(:query)
+      query['query_timeout'].to_f if Hash === query && query['query_timeout']
+    end
+
+    # Whether the connection still works, with a round trip to the server.
+    # Checked on idle pooled connections, see Pooling.pool_validation_interval.
+    # Drivers can override it with something cheaper.
+    def valid?
+      create_command('SELECT 1').execute_reader.close
+      true
+    rescue DataObjects::Error
+      false
+    end
+
     # Create a Command object of the right subclass using the given text
     def create_command(text)
       concrete_command.new(self, text)
@@ -147,4 +349,27 @@ module DataObjects
     end
 
   end
+
+  # Holds on to one connection per URI for the duration of the block, so
+  # Connection.new doesn't go through the pool every time. The connection is
+  # checked out when the block first asks for it, and released once the
+  # outermost block for the URI is left. See also DataObjects::Rack.
+  #
+  # ==== Examples
+  #   DataObjects.with_connection('postgres://localhost/app') do
+  #     Widget.all  # every Connection.new in here gets the same connection
+  #   end
+  def self.with_connection(*uris)
+    entered = []
+    begin
+      uris.each do |uri_s|
+        Connection.enter_sticky(uri_s)
+        entered << uri_s
+      end
+      yield
+    ensure
+      entered.reverse_each { |uri_s| Connection.leave_sticky(uri_s) }
+    end
+  end
+
 end
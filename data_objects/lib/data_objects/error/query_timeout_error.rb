@@ -0,0 +1,6 @@
+module DataObjects
+  # Raised when a command runs longer than its timeout, see Command#timeout.
+  # The query is cancelled on the server, so the connection can be used again.
+  class QueryTimeoutError < SQLError
+  end
+end
@@ -3,6 +3,7 @@
 #include <math.h>
 #include <ctype.h>
 #include <time.h>
+#include <errno.h>
 
 #include "do_common.h"
 
@@ -35,6 +36,7 @@ VALUE cDO_Logger_Message;
 VALUE cDO_Extension;
 VALUE eConnectionError;
 VALUE eDataError;
+VALUE eQueryTimeoutError;
 
 // References to Ruby classes that we'll need
 VALUE rb_cDate;
@@ -51,6 +53,10 @@ VALUE data_objects_const_get(VALUE scope, const char *constant) {
 }
 
 void data_objects_debug(VALUE connection, VALUE string, struct timeval *start) {
+  data_objects_debug_with_stats(connection, string, start, Qnil);
+}
+
+void data_objects_debug_with_stats(VALUE connection, VALUE string, struct timeval *start, VALUE stats) {
   struct timeval stop;
   VALUE message;
   do_int64 duration;
@@ -58,7 +64,7 @@ void data_objects_debug(VALUE connection, VALUE string, struct timeval *start) {
   gettimeofday(&stop, NULL);
   duration = (stop.tv_sec - start->tv_sec) * 1000000 + stop.tv_usec - start->tv_usec;
 
-  message = rb_funcall(cDO_Logger_Message, ID_NEW, 3, string, rb_time_new(start->tv_sec, start->tv_usec), INT2NUM(duration));
+  message = rb_funcall(cDO_Logger_Message, ID_NEW, 4, string, rb_time_new(start->tv_sec, start->tv_usec), INT2NUM(duration), stats);
 
   rb_funcall(connection, ID_LOG, 1, message);
 }
@@ -128,6 +134,327 @@ VALUE data_objects_build_query_from_args(VALUE klass, int count, VALUE *args) {
   return rb_funcall(klass, ID_ESCAPE, 1, array);
 }
 
+// Returns an IO for the socket of the connection, so waits on it can go
+// through rb_io_wait, and with that through the Fiber scheduler if there is
+// one. It's kept in @socket_io, and only replaced when the driver reconnected
+// on another socket. The IO doesn't own the socket, the driver closes it.
+VALUE data_objects_socket_io(VALUE connection, int fd) {
+  VALUE io = NIL_P(connection) ? Qnil : rb_iv_get(connection, "@socket_io");
+
+  if (NIL_P(io) || NUM2INT(rb_funcall(io, rb_intern("fileno"), 0)) != fd) {
+    io = rb_funcall(rb_cIO, rb_intern("for_fd"), 2, INT2NUM(fd), rb_str_new2("r+"));
+    rb_funcall(io, rb_intern("autoclose="), 1, Qfalse);
+
+    if (!NIL_P(connection)) {
+      rb_iv_set(connection, "@socket_io", io);
+    }
+  }
+
+  return io;
+}
+
+// Waits until the socket is readable or writable, see DO_WAIT_READABLE and
+// DO_WAIT_WRITABLE, or until the timeout passed. A NULL timeout waits for as
+// long as it takes. Returns the events that happened, 0 when the timeout
+// passed. Other threads keep running in the meantime, and under a Fiber
+// scheduler only the current fiber waits, so queries on many connections
+// interleave on one thread.
+int data_objects_wait_fd(VALUE connection, int fd, int events, struct timeval *timeout) {
+#if defined(HAVE_RB_IO_WAIT)
+  VALUE seconds = timeout ? rb_float_new(timeout->tv_sec + timeout->tv_usec / 1000000.0) : Qnil;
+  VALUE ready = rb_io_wait(data_objects_socket_io(connection, fd), INT2NUM(events), seconds);
+
+  return RTEST(ready) ? NUM2INT(ready) : 0;
+#elif defined(HAVE_RB_WAIT_FOR_SINGLE_FD)
+  int ready = rb_wait_for_single_fd(fd, events, timeout);
+
+  if (ready < 0) {
+    rb_sys_fail(0);
+  }
+
+  return ready;
+#else
+  struct timeval now, until;
+
+  if (!timeout) {
+    if (events & DO_WAIT_WRITABLE) {
+      rb_thread_fd_writable(fd);
+      return DO_WAIT_WRITABLE;
+    }
+
+    rb_thread_wait_fd(fd);
+    return DO_WAIT_READABLE;
+  }
+
+  // rb_thread_wait_fd can't time out: check without blocking, and let the
+  // other threads run in between
+  gettimeofday(&until, NULL);
+  until.tv_sec += timeout->tv_sec;
+  until.tv_usec += timeout->tv_usec;
+
+  if (until.tv_usec >= 1000000) {
+    until.tv_sec++;
+    until.tv_usec -= 1000000;
+  }
+
+  for (;;) {
+    fd_set read_set, write_set;
+    struct timeval poll = { 0, 0 }, pause = { 0, 1000 };
+    int ready = 0;
+
+    FD_ZERO(&read_set);
+    FD_ZERO(&write_set);
+
+    if (events & DO_WAIT_READABLE) {
+      FD_SET(fd, &read_set);
+    }
+
+    if (events & DO_WAIT_WRITABLE) {
+      FD_SET(fd, &write_set);
+    }
+
+    if (select(fd + 1, &read_set, &write_set, NULL, &poll) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      rb_sys_fail(0);
+    }
+
+    if (FD_ISSET(fd, &read_set)) {
+      ready |= DO_WAIT_READABLE;
+    }
+
+    if (FD_ISSET(fd, &write_set)) {
+      ready |= DO_WAIT_WRITABLE;
+    }
+
+    gettimeofday(&now, NULL);
+
+    if (ready || now.tv_sec > until.tv_sec || (now.tv_sec == until.tv_sec && now.tv_usec >= until.tv_usec)) {
+      return ready;
+    }
+
+    rb_thread_wait_for(pause);
+  }
+#endif
+}
+
+// The seconds the command may run, from Command#timeout, 0 for no limit
+double data_objects_query_timeout(VALUE command) {
+  VALUE timeout;
+
+  if (command == Qnil) {
+    return 0;
+  }
+
+  timeout = rb_funcall(command, rb_intern("timeout"), 0);
+  return timeout == Qnil ? 0 : NUM2DBL(timeout);
+}
+
+// Fills in the time the given number of seconds from now. Returns NULL
+// without a timeout, which data_objects_wait_fd_until takes as forever.
+struct timeval *data_objects_deadline(double seconds, struct timeval *deadline) {
+  if (seconds <= 0) {
+    return NULL;
+  }
+
+  gettimeofday(deadline, NULL);
+  deadline->tv_sec += (long)seconds;
+  deadline->tv_usec += (long)((seconds - (long)seconds) * 1000000);
+
+  if (deadline->tv_usec >= 1000000) {
+    deadline->tv_sec++;
+    deadline->tv_usec -= 1000000;
+  }
+
+  return deadline;
+}
+
+int data_objects_deadline_passed(struct timeval *deadline) {
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return now.tv_sec > deadline->tv_sec || (now.tv_sec == deadline->tv_sec && now.tv_usec >= deadline->tv_usec);
+}
+
+// Like data_objects_wait_fd, with a deadline instead of a timeout. Returns 0
+// once the deadline has passed.
+int data_objects_wait_fd_until(VALUE connection, int fd, int events, struct timeval *deadline) {
+  struct timeval now, remaining;
+
+  if (!deadline) {
+    return data_objects_wait_fd(connection, fd, events, NULL);
+  }
+
+  gettimeofday(&now, NULL);
+
+  if (now.tv_sec > deadline->tv_sec || (now.tv_sec == deadline->tv_sec && now.tv_usec >= deadline->tv_usec)) {
+    return 0;
+  }
+
+  remaining.tv_sec = deadline->tv_sec - now.tv_sec;
+  remaining.tv_usec = deadline->tv_usec - now.tv_usec;
+
+  if (remaining.tv_usec < 0) {
+    remaining.tv_sec--;
+    remaining.tv_usec += 1000000;
+  }
+
+  return data_objects_wait_fd(connection, fd, events, &remaining);
+}
+
+void data_objects_raise_query_timeout(VALUE self, double timeout, VALUE query) {
+  char message[64];
+  VALUE uri = rb_funcall(rb_iv_get(self, "@connection"), rb_intern("to_s"), 0);
+
+  snprintf(message, sizeof(message), "Query timed out after %g seconds", timeout);
+
+  rb_exc_raise(rb_funcall(eQueryTimeoutError, ID_NEW, 5, rb_str_new2(message), Qnil, Qnil, query, uri));
+}
+
+#ifdef HAVE_POLL
+struct data_objects_poll_args {
+  VALUE *connections;
+  struct pollfd *fds;
+  unsigned long count;
+  struct timeval *deadline;
+  int timeout;
+  int result;
+  int error;
+};
+
+// The milliseconds left until the deadline, rounded up, for poll(2): -1
+// without a deadline, 0 once it has passed.
+static int data_objects_poll_timeout(struct timeval *deadline) {
+  struct timeval now;
+  long remaining;
+
+  if (!deadline) {
+    return -1;
+  }
+
+  gettimeofday(&now, NULL);
+  remaining = (deadline->tv_sec - now.tv_sec) * 1000000 + deadline->tv_usec - now.tv_usec;
+  return remaining > 0 ? (int)((remaining + 999) / 1000) : 0;
+}
+
+#if defined(HAVE_RB_THREAD_CALL_WITHOUT_GVL) || defined(HAVE_RB_THREAD_BLOCKING_REGION)
+static void *data_objects_poll_without_gvl(void *ptr) {
+  struct data_objects_poll_args *args = ptr;
+
+  args->result = poll(args->fds, args->count, args->timeout);
+  args->error = errno;
+  return NULL;
+}
+#endif
+
+#if !defined(HAVE_RB_THREAD_CALL_WITHOUT_GVL) && defined(HAVE_RB_THREAD_BLOCKING_REGION)
+static VALUE data_objects_poll_blocking_region(void *ptr) {
+  data_objects_poll_without_gvl(ptr);
+  return Qnil;
+}
+#endif
+
+static void data_objects_poll_blocking(struct data_objects_poll_args *args) {
+#if defined(HAVE_RB_THREAD_CALL_WITHOUT_GVL)
+  args->result = -1;
+  args->error = EINTR;
+  args->timeout = data_objects_poll_timeout(args->deadline);
+  rb_thread_call_without_gvl(data_objects_poll_without_gvl, args, RUBY_UBF_IO, NULL);
+#elif defined(HAVE_RB_THREAD_BLOCKING_REGION)
+  args->result = -1;
+  args->error = EINTR;
+  args->timeout = data_objects_poll_timeout(args->deadline);
+  rb_thread_blocking_region(data_objects_poll_blocking_region, args, RUBY_UBF_IO, NULL);
+#else
+  // Green threads: check without blocking, and let the others run
+  while ((args->result = poll(args->fds, args->count, 0)) == 0 && data_objects_poll_timeout(args->deadline) != 0) {
+    struct timeval pause = { 0, 1000 };
+    rb_thread_wait_for(pause);
+  }
+
+  args->error = errno;
+#endif
+}
+
+#ifdef HAVE_RB_FIBER_SCHEDULER_CURRENT
+// How long a scheduled poll waits on one socket before it moves on to the next
+#define DATA_OBJECTS_POLL_SLICE 10000
+
+// Under a Fiber scheduler only the current fiber may block: it waits on each
+// socket in turn through the scheduler, a slice at a time, and checks all of
+// them without blocking in between, so whichever is ready first is noticed
+// within a slice. Returns 0 when there's no scheduler.
+static int data_objects_poll_scheduled(struct data_objects_poll_args *args) {
+  unsigned long i = 0;
+  int timeout;
+
+  if (NIL_P(rb_fiber_scheduler_current())) {
+    return 0;
+  }
+
+  while ((args->result = poll(args->fds, args->count, 0)) == 0 && (timeout = data_objects_poll_timeout(args->deadline)) != 0) {
+    long wait = args->count > 1 ? DATA_OBJECTS_POLL_SLICE : -1;
+    struct timeval slice;
+    VALUE connection = args->connections ? args->connections[i] : Qnil;
+    int events = (args->fds[i].events & POLLOUT) ? DO_WAIT_WRITABLE : DO_WAIT_READABLE;
+
+    if (timeout > 0 && (wait < 0 || timeout * 1000L < wait)) {
+      wait = timeout * 1000L;
+    }
+
+    slice.tv_sec = wait / 1000000;
+    slice.tv_usec = wait % 1000000;
+
+    data_objects_wait_fd(connection, args->fds[i].fd, events, wait < 0 ? NULL : &slice);
+    i = (i + 1) % args->count;
+  }
+
+  args->error = errno;
+  return 1;
+}
+#endif
+
+// Waits until at least one of the sockets is ready, and returns the number
+// of ready sockets like poll(2), 0 once the deadline has passed. A NULL
+// deadline waits for as long as it takes. Other threads keep running in the
+// meantime. Unlike select(2), this works for sockets above FD_SETSIZE. The
+// connections own the sockets, one for each, so their IOs are reused under
+// a Fiber scheduler; pass NULL when there are none.
+int data_objects_poll(VALUE *connections, struct pollfd *fds, unsigned long count, struct timeval *deadline) {
+  struct data_objects_poll_args args;
+
+  args.connections = connections;
+  args.fds = fds;
+  args.count = count;
+  args.deadline = deadline;
+
+  while (1) {
+#ifdef HAVE_RB_FIBER_SCHEDULER_CURRENT
+    if (!data_objects_poll_scheduled(&args)) {
+      data_objects_poll_blocking(&args);
+    }
+#else
+    data_objects_poll_blocking(&args);
+#endif
+
+    if (args.result >= 0) {
+      return args.result;
+    }
+
+    if (args.error != EINTR) {
+      errno = args.error;
+      rb_sys_fail("poll");
+    }
+
+#ifdef HAVE_RB_THREAD_CHECK_INTS
+    rb_thread_check_ints();
+#endif
+  }
+}
+#endif
+
 // Find the greatest common denominator and reduce the provided numerator and denominator.
 // This replaces calles to Rational.reduce! which does the same thing, but really slowly.
 void data_objects_reduce(do_int64 *numerator, do_int64 *denominator) {
@@ -428,6 +755,7 @@ void data_objects_common_init(void) {
 
   eConnectionError = data_objects_const_get(mDO, "ConnectionError");
   eDataError = data_objects_const_get(mDO, "DataError");
+  eQueryTimeoutError = data_objects_const_get(mDO, "QueryTimeoutError");
 
   rb_global_variable(&ID_NEW_DATE);
   rb_global_variable(&ID_RATIONAL);
@@ -446,6 +774,7 @@ void data_objects_common_init(void) {
 
   rb_global_variable(&eConnectionError);
   rb_global_variable(&eDataError);
+  rb_global_variable(&eQueryTimeoutError);
 
   tzset();
 }
@@ -3,6 +3,26 @@
 
 #include <ruby.h>
 
+#ifdef HAVE_RUBY_THREAD_H
+#include <ruby/thread.h>
+#endif
+
+#ifdef HAVE_RUBY_IO_H
+#include <ruby/io.h>
+#endif
+
+#ifdef HAVE_RUBY_FIBER_SCHEDULER_H
+#include <ruby/fiber/scheduler.h>
+#endif
+
+#ifdef HAVE_POLL
+#include <poll.h>
+#endif
+
+// Events for data_objects_wait_fd, the same as RB_WAITFD_IN and RB_WAITFD_OUT
+#define DO_WAIT_READABLE 0x001
+#define DO_WAIT_WRITABLE 0x004
+
 // Needed for defining error.h
 struct errcodes {
   int error_no;
@@ -79,6 +99,7 @@ extern VALUE cDO_Logger_Message;
 extern VALUE cDO_Extension;
 extern VALUE eConnectionError;
 extern VALUE eDataError;
+extern VALUE eQueryTimeoutError;
 
 // References to Ruby classes that we'll need
 extern VALUE rb_cDate;
@@ -86,10 +107,24 @@ extern VALUE rb_cDateTime;
 extern VALUE rb_cBigDecimal;
 
 extern void data_objects_debug(VALUE connection, VALUE string, struct timeval *start);
+extern void data_objects_debug_with_stats(VALUE connection, VALUE string, struct timeval *start, VALUE stats);
 extern char *data_objects_get_uri_option(VALUE query_hash, const char *key);
 extern void data_objects_assert_file_exists(char *file, const char *message);
 extern VALUE data_objects_build_query_from_args(VALUE klass, int count, VALUE *args);
 
+extern VALUE data_objects_socket_io(VALUE connection, int fd);
+extern int data_objects_wait_fd(VALUE connection, int fd, int events, struct timeval *timeout);
+
+extern double data_objects_query_timeout(VALUE command);
+extern struct timeval *data_objects_deadline(double seconds, struct timeval *deadline);
+extern int data_objects_deadline_passed(struct timeval *deadline);
+extern int data_objects_wait_fd_until(VALUE connection, int fd, int events, struct timeval *deadline);
+NORETURN(extern void data_objects_raise_query_timeout(VALUE self, double timeout, VALUE query));
+
+#ifdef HAVE_POLL
+extern int data_objects_poll(VALUE *connections, struct pollfd *fds, unsigned long count, struct timeval *deadline);
+#endif
+
 extern void data_objects_reduce(do_int64 *numerator, do_int64 *denominator);
 extern int data_objects_jd_from_date(int year, int month, int day);
 extern VALUE data_objects_seconds_to_offset(long seconds_offset);
@@ -7,8 +7,11 @@ module DataObjects
     def log(message)
       logger = driver_namespace.logger
       if logger.level <= DataObjects::Logger::LEVELS[:debug]
-        message = "(%.6f) %s" % [message.duration / 1000000.0, message.query]
-        logger.debug message
+        text = "(%.6f) %s" % [message.duration / 1000000.0, message.query]
+        if message.stats && !message.stats.empty?
+          text << " [" << message.stats.map { |name, count| "#{name}=#{count}" }.join(' ') << "]"
+        end
+        logger.debug text
       end
     end
 
@@ -63,7 +66,9 @@ module DataObjects
     # The name of the log file
     attr_reader   :log
 
-    Message = Struct.new(:query, :start, :duration)
+    # A logged query. +stats+ optionally holds driver specific execution
+    # counters, for example how many full table scan steps were taken.
+    Message = Struct.new(:query, :start, :duration, :stats)
 
     #
     # Ruby (standard) logger levels:
@@ -53,16 +53,20 @@ module DataObjects
             # Otherwise we might clean up something we just made
             sleep(scavenger_interval)
 
+            # Evicting and replenishing instances can take a while, so it's
+            # done without holding the global lock. That's only needed to
+            # dispose of empty pools.
+            lock.synchronize { pools.to_a }.each do |pool|
+              pool.scavenge
+            end
+
             lock.synchronize do
-              pools.each do |pool|
-                # This is a useful check, but non-essential, and right now it breaks lots of stuff.
-                # if pool.expired?
+              pools.to_a.each do |pool|
                 pool.lock.synchronize do
                   if pool.expired?
                     pool.dispose
                   end
                 end
-                # end
               end
 
               # The pool is empty, we stop the scavenger
@@ -94,29 +98,67 @@ module DataObjects
       @lock ||= Mutex.new
     end
 
+    # Resets every pool in a forked child right away, instead of on its
+    # first checkout. Meant for after_fork hooks of preforking servers.
+    def self.after_fork
+      lock.synchronize { pools.to_a }.each do |pool|
+        pool.reset_after_fork
+      end
+    end
+
     class InvalidResourceError < StandardError
     end
 
+    # Raised when no instance became available within the checkout timeout.
+    class CheckoutTimeoutError < StandardError
+    end
+
+    # Default number of seconds Pool#new waits for an instance before it
+    # raises CheckoutTimeoutError. Waits forever when nil.
+    def self.checkout_timeout
+      @checkout_timeout
+    end
+
+    def self.checkout_timeout=(timeout)
+      @checkout_timeout = timeout
+    end
+
     def self.included(target)
       target.class_eval do
         class << self
           alias __new new
         end
 
-        @__pools     = {}
-        @__pool_lock = Mutex.new
-        @__pool_wait = ConditionVariable.new
+        @__pools         = {}
+        @__pool_settings = {}
+        @__pool_lock     = Mutex.new
 
         def self.__pool_lock
           @__pool_lock
         end
 
-        def self.__pool_wait
-          @__pool_wait
+        def self.new(*args)
+          __pool(*args).new
         end
 
-        def self.new(*args)
-          (@__pools[args] ||= __pool_lock.synchronize { Pool.new(self.pool_size, self, args) }).new
+        # Pools are created with the settings made through __configure_pool,
+        # so they're kept when the scavenger disposed of an empty pool.
+        def self.__pool(*args)
+          @__pools[args] || __pool_lock.synchronize do
+            @__pools[args] ||= begin
+              pool = Pool.new(self.pool_size, self, args)
+              (@__pool_settings[args] || {}).each_value { |setting| setting.call(pool) }
+              pool
+            end
+          end
+        end
+
+        # Applies the block to the pool for the arguments, and to every pool
+        # created for them later on. A setting with the same name replaces
+        # the earlier one.
+        def self.__configure_pool(name, *args, &block)
+          __pool_lock.synchronize { (@__pool_settings[args] ||= {})[name] = block }
+          block.call(__pool(*args))
         end
 
         def self.__pools
@@ -126,119 +168,718 @@ module DataObjects
         def self.pool_size
           8
         end
+
+        def self.pool_checkout_timeout
+          DataObjects::Pooling.checkout_timeout
+        end
+
+        # Number of idle instances the scavenger keeps around.
+        def self.pool_min_idle
+          0
+        end
+
+        def self.pool_max_idle_time
+          DataObjects::Pooling.scavenger_interval
+        end
+
+        # Instances are discarded once they're older than this, give or take
+        # LIFETIME_JITTER, so instances created together don't expire together.
+        def self.pool_max_lifetime
+          nil
+        end
+
+        # Share of the pool that checkouts with the :batch priority can use.
+        def self.pool_batch_share
+          0.5
+        end
+
+        # The scavenger checks instances that have been idle this long with
+        # their valid? method, and discards the ones that fail. Not checked
+        # when nil.
+        def self.pool_validation_interval
+          nil
+        end
       end
     end
 
+    # Returns the instance to its pool, unless it's held for the rest of a
+    # DataObjects.with_connection block.
     def release
-      @__pool.release(self) unless @__pool.nil?
+      return if @__pool.nil? || @__sticky
+
+      # The next one to check it out gets the timeout of the URI again
+      @query_timeout = nil
+
+      # A query sent with Command#send_reader and never picked up with
+      # get_result is cancelled, so it doesn't hold up the next one
+      discard_pending if respond_to?(:discard_pending, true)
+      @__pool.release(self)
     end
 
     def detach
       @__pool.delete(self) unless @__pool.nil?
     end
 
+    # ==== Notes
+    # Checking out an instance goes through three steps, from cheap to
+    # expensive:
+    #
+    # 1. The instance this thread released last, if nobody took it since.
+    #    This only takes the uncontended lock of that instance's entry.
+    # 2. The idle stacks. Idle instances are spread over a few shards, each
+    #    with its own lock, and every thread starts at its own shard.
+    # 3. The checkout lock, to create a new instance or to queue up until
+    #    a releasing thread hands one over. Waiters are served in FIFO order
+    #    and give up after the pool_checkout_timeout of the resource.
+    #
+    # Checkouts have a priority, :interactive (the default) or :batch. Batch
+    # checkouts always take the checkout lock, can hold no more than the
+    # pool_batch_share of the pool, and are only served once no interactive
+    # checkout is waiting.
+    #
+    # The resource level lock (Pool#lock) is only used for maintenance, like
+    # scavenging and disposing pools.
+    #
+    # A pool notices it was inherited by a forked process on the next
+    # checkout, and starts over without the instances of the parent.
     class Pool
-      attr_reader :available
-      attr_reader :used
+
+      MAX_SHARDS = 8
+
+      LIFETIME_JITTER = 0.1
+
+      # Tracks the state of a pooled instance. An idle entry can be claimed
+      # by the thread that released it and by threads taking it from the idle
+      # stacks at the same time, so every state change goes through the lock
+      # of the entry.
+      class Entry
+        attr_reader :instance, :released_at, :validated_at, :pid, :slot
+
+        # Whether the entry is checked out with the :batch priority.
+        attr_accessor :batch
+
+        def initialize(instance, lifetime, slot = nil)
+          @instance     = instance
+          @slot         = slot
+          @pid          = Process.pid
+          @lock         = Mutex.new
+          @state        = :used
+          @listed       = false
+          @released_at  = Time.now
+          @validated_at = @released_at
+          @expires_at   = @released_at + lifetime if lifetime
+        end
+
+        def used?
+          @state == :used
+        end
+
+        def idle?
+          @state == :idle
+        end
+
+        def expired?(now)
+          !@expires_at.nil? && @expires_at <= now
+        end
+
+        # Claims an idle entry through a thread cache.
+        def claim
+          @lock.synchronize { transition(:idle, :used) }
+        end
+
+        # Claims (or retires) an entry that was removed from an idle stack.
+        def take(state = :used)
+          @lock.synchronize do
+            @listed = false
+            transition(:idle, state)
+          end
+        end
+
+        # Returns true if the entry should be pushed onto an idle stack, false
+        # if it's still listed on one from an earlier release.
+        def release
+          @lock.synchronize do
+            return false unless transition(:used, :idle)
+            @released_at = @validated_at = Time.now
+            listed, @listed = @listed, true
+            !listed
+          end
+        end
+
+        # Makes an entry taken for validation idle again, without counting
+        # the validation as a use. It's pushed back onto an idle stack.
+        def restore
+          @lock.synchronize do
+            return false unless transition(:validating, :idle)
+            @validated_at = Time.now
+            @listed = true
+          end
+        end
+
+        def retire
+          @lock.synchronize { @state = :disposed }
+        end
+
+        private
+
+        def transition(from, to)
+          return false unless @state == from
+          @state = to
+          true
+        end
+      end
+
+      # A thread queued in Pool#new. It's granted either an entry or, when an
+      # instance was deleted, the room to create a new one.
+      class Waiter
+        def initialize
+          @signal = ConditionVariable.new
+          @grant  = nil
+        end
+
+        # Returns nil if nothing was granted within +timeout+ seconds.
+        def wait(lock, timeout)
+          deadline = Time.now + timeout if timeout
+          until @grant
+            if timeout
+              remaining = deadline - Time.now
+              return nil if remaining <= 0
+              @signal.wait(lock, remaining)
+            else
+              @signal.wait(lock)
+            end
+          end
+          @grant
+        end
+
+        def grant(entry)
+          @grant = entry
+          @signal.signal
+        end
+      end
+
+      Shard = Struct.new(:lock, :stack)
 
       def initialize(max_size, resource, args)
-        raise ArgumentError.new("+max_size+ should be a Fixnum but was #{max_size.inspect}") unless Fixnum === max_size
+        raise ArgumentError.new("+max_size+ should be an Integer but was #{max_size.inspect}") unless Integer === max_size
         raise ArgumentError.new("+resource+ should be a Class but was #{resource.inspect}") unless Class === resource
 
         @max_size = max_size
         @resource = resource
         @args = args
 
-        @available = []
-        @used      = {}
+        @checkout_lock = Mutex.new
+        @size          = 0
+        @waiters       = []
+        @batch_waiters = []
+        @batch_in_use  = 0
+        @stats         = new_stats
+        @callbacks     = {}
+        @shards        = Array.new([[max_size, 1].max, MAX_SHARDS].min) { Shard.new(Mutex.new, []) }
+        @entries       = {}
+        @thread_cache  = ObjectSpace::WeakMap.new
+        @pid           = Process.pid
+        @prewarm_after_fork = nil
         DataObjects::Pooling.append_pool(self)
       end
 
+      # Number of instances to prewarm in a forked child, nil for none.
+      attr_accessor :prewarm_after_fork
+
+      # A GlobalLimit every new instance needs a slot of, nil for none.
+      attr_accessor :global_limit
+
+      # The ConcurrencyLimiter commands on these instances go through, nil
+      # for none.
+      attr_accessor :concurrency_limiter
+
+      # The AutoSizer that resizes the pool on every scavenger run, nil for
+      # none.
+      attr_accessor :auto_sizer
+
+      attr_reader :max_size
+
+      # Changes the maximum size of the pool. When it shrinks, idle instances
+      # beyond the new size are discarded right away, instances in use once
+      # they're released.
+      def resize(max_size)
+        raise ArgumentError.new("+max_size+ should be a positive Integer but was #{max_size.inspect}") unless Integer === max_size && max_size > 0
+
+        @checkout_lock.synchronize do
+          @max_size = max_size
+          while @size < @max_size && waiter = next_waiter
+            @size += 1
+            waiter.grant(:create)
+          end
+        end
+
+        while @size > @max_size && entry = pop_idle(:disposed)
+          discard(entry)
+        end
+      end
+
       def lock
         @resource.__pool_lock
       end
 
-      def wait
-        @resource.__pool_wait
-      end
+      def new(priority = :interactive)
+        reset_after_fork if @pid != Process.pid
 
-      def scavenge_interval
-        @resource.scavenge_interval
-      end
+        case priority
+        when :interactive
+          entry = @thread_cache[Thread.current]
+          return entry.instance if entry && entry.claim
 
-      def new
-        instance = nil
-        begin
-          lock.synchronize do
-            if @available.size > 0
-              instance = @available.pop
-              @used[instance.object_id] = instance
-            elsif @used.size < @max_size
-              instance = @resource.__new(*@args)
-              raise InvalidResourceError.new("#{@resource} constructor created a nil object") if instance.nil?
-              raise InvalidResourceError.new("#{instance} is already part of the pool") if @used.include? instance
-              instance.instance_variable_set(:@__pool, self)
-              instance.instance_variable_set(:@__allocated_in_pool, Time.now)
-              @used[instance.object_id] = instance
-            else
-              # Wait for another thread to release an instance.
-              # If we exhaust the pool and don't release the active instance,
-              # we'll wait here forever, so it's *very* important to always
-              # release your services and *never* exhaust the pool within
-              # a single thread.
-              wait.wait(lock)
+          (pop_idle || create_or_wait(:interactive)).instance
+        when :batch
+          entry = @checkout_lock.synchronize do
+            if @batch_in_use < batch_limit && entry = pop_idle
+              @batch_in_use += 1
+              entry
             end
           end
-        end until instance
-        instance
+          entry ||= create_or_wait(:batch)
+          entry.batch = true
+          entry.instance
+        else
+          raise ArgumentError.new("+priority+ should be :interactive or :batch but was #{priority.inspect}")
+        end
       end
 
       def release(instance)
-        lock.synchronize do
-          instance.instance_variable_set(:@__allocated_in_pool, Time.now)
-          @used.delete(instance.object_id)
-          @available.push(instance) unless @available.include?(instance)
-          wait.signal
+        entry = instance.instance_variable_get(:@__pool_entry)
+        return nil if entry.nil? || !entry.used?
+
+        reset_after_fork if @pid != Process.pid
+
+        if entry.pid != @pid
+          # Checked out in the parent before the fork
+          forget(entry)
+          return nil
+        end
+
+        finish_batch(entry) if entry.batch
+
+        if entry.expired?(Time.now)
+          entry.retire
+          discard(entry)
+        else
+          check_in(entry)
+          @thread_cache[Thread.current] = entry
         end
         nil
       end
 
       def delete(instance)
-        lock.synchronize do
-          instance.instance_variable_set(:@__pool, nil)
-          @used.delete(instance.object_id)
-          wait.signal
+        entry = instance.instance_variable_get(:@__pool_entry)
+        instance.instance_variable_set(:@__pool, nil)
+        instance.instance_variable_set(:@__pool_entry, nil)
+        unless entry.nil?
+          entry.retire
+          @checkout_lock.synchronize { @entries.delete(entry) }
+          finish_batch(entry) if entry.batch
+          release_slot(entry.slot)
+          vacate
         end
         nil
       end
 
+      # Registers a block that's called with every new instance before it's
+      # handed out. Registering another block under the same name replaces
+      # the earlier one.
+      def on_create(name, &block)
+        @callbacks[name] = block
+      end
+
+      # Creates instances in parallel until the pool holds +count+ of them,
+      # or is full. Returns the size of the pool.
+      def prewarm(count)
+        count = [count, @max_size].min
+        threads = []
+        while @checkout_lock.synchronize { @size += 1 if @size < count }
+          threads << Thread.new do
+            begin
+              check_in(create)
+              nil
+            rescue Exception => error
+              error
+            end
+          end
+        end
+        error = threads.map { |thread| thread.value }.compact.first
+        raise error if error
+        size
+      end
+
+      # Drops the instances inherited from the parent process. Disposing of
+      # them would close the connections the parent is still using, so they
+      # are forgotten instead. The child gets its own locks, starts its own
+      # scavenger and, if prewarm_after_fork is set, opens its own instances.
+      def reset_after_fork
+        lock.synchronize do
+          return if @pid == Process.pid
+
+          @shards.each do |shard|
+            shard.stack.each { |entry| forget(entry) if entry.take(:disposed) }
+          end
+
+          @checkout_lock = Mutex.new
+          @size          = 0
+          @waiters       = []
+          @batch_waiters = []
+          @batch_in_use  = 0
+          @stats         = new_stats
+          @shards        = Array.new(@shards.size) { Shard.new(Mutex.new, []) }
+          @entries       = {}
+          @thread_cache  = ObjectSpace::WeakMap.new
+          @pid           = Process.pid
+        end
+
+        @global_limit.reset_after_fork if @global_limit
+        DataObjects::Pooling.scavenger
+        prewarm(@prewarm_after_fork) if @prewarm_after_fork
+      end
+
       def size
-        @used.size + @available.size
+        @size
       end
       alias length size
 
+      # The idle instances.
+      def available
+        idle = []
+        @shards.each do |shard|
+          shard.lock.synchronize { shard.stack.each { |entry| idle << entry.instance if entry.idle? } }
+        end
+        idle
+      end
+
+      # The checked out instances, by object_id.
+      def used
+        used = {}
+        @checkout_lock.synchronize { @entries.keys }.each do |entry|
+          used[entry.instance.object_id] = entry.instance if entry.used?
+        end
+        used
+      end
+
+      # Returns a snapshot of the checkout counters: the number of checkouts
+      # that had to wait, the total and longest wait in seconds, and the
+      # number of checkouts that timed out. The same counters per priority
+      # are under :interactive and :batch.
+      def stats
+        @checkout_lock.synchronize do
+          stats = @stats.dup
+          stats[:interactive] = @stats[:interactive].dup
+          stats[:batch]       = @stats[:batch].dup
+          stats
+        end
+      end
+
+      # The number of instances :batch checkouts can hold at once.
+      def batch_limit
+        [(@max_size * @resource.pool_batch_share).floor, 1].max
+      end
+
       def inspect
-        "#<DataObjects::Pooling::Pool<#{@resource.name}> available=#{@available.size} used=#{@used.size} size=#{@max_size}>"
+        "#<DataObjects::Pooling::Pool<#{@resource.name}> available=#{available.size} used=#{used.size} size=#{@max_size}>"
       end
 
       def flush!
-        @available.pop.dispose until @available.empty?
+        @shards.each do |shard|
+          while entry = shard.lock.synchronize { shard.stack.pop }
+            discard(entry) if entry.take(:disposed)
+          end
+        end
       end
 
+      # Flushes the pool and forgets it. The thread caches are dropped with
+      # it, so they don't keep its instances around.
       def dispose
         flush!
+        @thread_cache = ObjectSpace::WeakMap.new
         @resource.__pools.delete(@args)
         !DataObjects::Pooling.pools.delete?(self).nil?
       end
 
       def expired?
-        @available.each do |instance|
-          if DataObjects.exiting || instance.instance_variable_get(:@__allocated_in_pool) + DataObjects::Pooling.scavenger_interval <= (Time.now + 0.02)
-            instance.dispose
-            @available.delete(instance)
+        size == 0
+      end
+
+      # Discards idle instances that have outlived their lifetime or have
+      # been idle for longer than the max idle time, and then creates new
+      # instances until there are min idle ones again. Instances are evicted
+      # one at a time, so checkouts carry on in the meantime.
+      def scavenge
+        now       = Time.now
+        idle      = available.size
+        min_idle  = @resource.pool_min_idle
+        idle_time = @resource.pool_max_idle_time
+
+        @shards.each do |shard|
+          shard.lock.synchronize { shard.stack.dup }.each do |entry|
+            next unless DataObjects.exiting || entry.expired?(now) ||
+              (idle > min_idle && entry.released_at + idle_time <= (now + 0.02))
+            next unless shard.lock.synchronize { shard.stack.delete(entry) }
+            if entry.take(:disposed)
+              discard(entry)
+              idle -= 1
+            end
           end
         end
-        size == 0
+
+        interval = @resource.pool_validation_interval
+        validate(now - interval) if interval && !DataObjects.exiting
+
+        replenish(min_idle) unless DataObjects.exiting
+        @auto_sizer.adjust(self) if @auto_sizer
+      end
+
+      private
+
+      def check_in(entry)
+        if @size > @max_size
+          # The pool was resized
+          entry.retire
+          return discard(entry)
+        end
+
+        return if hand_off(entry)
+        push_idle(entry) if entry.release
+
+        # A thread may have queued up after hand_off looked at the queue, and
+        # missed the entry we just pushed.
+        hand_off_idle if waiting?
+      end
+
+      # Checks the idle instances that weren't used or checked since
+      # +before+, one at a time. Nobody can check an instance out while it's
+      # checked.
+      def validate(before)
+        @shards.each do |shard|
+          shard.lock.synchronize { shard.stack.dup }.each do |entry|
+            next unless entry.idle? && entry.validated_at <= before
+            next unless shard.lock.synchronize { shard.stack.delete(entry) }
+            next unless entry.take(:validating)
+
+            if valid?(entry.instance) && entry.restore
+              shard.lock.synchronize { shard.stack.push(entry) }
+              hand_off_idle if waiting?
+            else
+              entry.retire
+              discard(entry)
+            end
+          end
+        end
+      end
+
+      def valid?(instance)
+        !instance.respond_to?(:valid?) || instance.valid?
+      rescue StandardError
+        false
+      end
+
+      def new_stats
+        counters = lambda { { :waits => 0, :wait_time => 0.0, :max_wait_time => 0.0, :timeouts => 0 } }
+        counters.call.merge(:interactive => counters.call, :batch => counters.call)
+      end
+
+      def finish_batch(entry)
+        entry.batch = false
+        @checkout_lock.synchronize { @batch_in_use -= 1 }
+      end
+
+      def replenish(min_idle)
+        while available.size < min_idle
+          reserved = @checkout_lock.synchronize do
+            @size += 1 if @size < @max_size
+          end
+          break unless reserved
+          check_in(create)
+        end
+      rescue StandardError
+        # The database may be unreachable, try again on the next run
+      end
+
+      def home_shard
+        Thread.current.hash % @shards.size
+      end
+
+      def push_idle(entry)
+        shard = @shards[home_shard]
+        shard.lock.synchronize { shard.stack.push(entry) }
+      end
+
+      def pop_idle(state = :used)
+        home = home_shard
+        @shards.size.times do |i|
+          shard = @shards[(home + i) % @shards.size]
+          while entry = shard.lock.synchronize { shard.stack.pop }
+            # Entries claimed through a thread cache are dropped here, and
+            # pushed again when they're released.
+            return entry if entry.take(state)
+          end
+        end
+        nil
+      end
+
+      def create_or_wait(priority)
+        batch = priority == :batch
+        grant = @checkout_lock.synchronize do
+          if batch && @batch_in_use >= batch_limit
+            wait_for(Waiter.new, priority)
+          elsif @size < @max_size
+            @size += 1
+            @batch_in_use += 1 if batch
+            nil
+          else
+            # If we exhaust the pool and don't release the active instance,
+            # we'll wait here forever, so it's *very* important to always
+            # release your services and *never* exhaust the pool within
+            # a single thread.
+            waiter = Waiter.new
+            queue  = batch ? @batch_waiters : @waiters
+            queue.push(waiter)
+            if entry = pop_idle
+              queue.delete(waiter)
+              @batch_in_use += 1 if batch
+              entry
+            else
+              wait_for(waiter, priority, false)
+            end
+          end
+        end
+        return grant if Entry === grant
+
+        begin
+          create
+        rescue Exception
+          @checkout_lock.synchronize { @batch_in_use -= 1 } if batch
+          raise
+        end
+      end
+
+      # Called with the checkout lock held.
+      def wait_for(waiter, priority, enqueue = true)
+        queue = priority == :batch ? @batch_waiters : @waiters
+        queue.push(waiter) if enqueue
+
+        timeout = @resource.pool_checkout_timeout
+        started = Time.now
+        grant = waiter.wait(@checkout_lock, timeout)
+        waited = Time.now - started
+
+        [@stats, @stats[priority]].each do |stats|
+          stats[:waits] += 1
+          stats[:wait_time] += waited
+          stats[:max_wait_time] = waited if waited > stats[:max_wait_time]
+          stats[:timeouts] += 1 if grant.nil?
+        end
+
+        if grant.nil?
+          queue.delete(waiter)
+          raise CheckoutTimeoutError.new("Could not check out #{@resource} within #{timeout} seconds (pool size #{@max_size})")
+        end
+
+        grant
+      end
+
+      # Creates a new instance in a slot that was already counted in @size.
+      def create
+        slot = nil
+        begin
+          slot = acquire_slot if @global_limit
+          instance = @resource.__new(*@args)
+          raise InvalidResourceError.new("#{@resource} constructor created a nil object") if instance.nil?
+          raise InvalidResourceError.new("#{instance} is already part of the pool") unless instance.instance_variable_get(:@__pool_entry).nil?
+          @callbacks.each_value { |callback| callback.call(instance) }
+        rescue Exception
+          instance.dispose if instance && instance.instance_variable_get(:@__pool_entry).nil?
+          release_slot(slot)
+          vacate
+          raise
+        end
+
+        lifetime = @resource.pool_max_lifetime
+        entry = Entry.new(instance, lifetime && lifetime * (1 - LIFETIME_JITTER * rand), slot)
+        instance.instance_variable_set(:@__pool, self)
+        instance.instance_variable_set(:@__pool_entry, entry)
+        @checkout_lock.synchronize { @entries[entry] = true }
+        entry
+      end
+
+      def acquire_slot
+        timeout = @resource.pool_checkout_timeout
+        slot = @global_limit.acquire(timeout)
+        if slot.nil?
+          @checkout_lock.synchronize { @stats[:timeouts] += 1 }
+          raise CheckoutTimeoutError.new("Could not check out #{@resource} within #{timeout} seconds (global limit #{@global_limit.max})")
+        end
+        slot
+      end
+
+      def release_slot(slot)
+        @global_limit.release(slot) if slot && @global_limit
+      end
+
+      def waiting?
+        !@waiters.empty? || !@batch_waiters.empty?
+      end
+
+      # Returns the waiter to serve next, interactive ones first, and counts
+      # a batch waiter towards the batch limit. Called with the checkout lock
+      # held.
+      def next_waiter
+        if waiter = @waiters.shift
+          waiter
+        elsif !@batch_waiters.empty? && @batch_in_use < batch_limit
+          @batch_in_use += 1
+          @batch_waiters.shift
+        end
+      end
+
+      def hand_off(entry)
+        return false unless waiting?
+        @checkout_lock.synchronize do
+          return false unless waiter = next_waiter
+          waiter.grant(entry)
+        end
+        true
+      end
+
+      def hand_off_idle
+        @checkout_lock.synchronize do
+          while !@waiters.empty? || (!@batch_waiters.empty? && @batch_in_use < batch_limit)
+            break unless entry = pop_idle
+            next_waiter.grant(entry)
+          end
+        end
+      end
+
+      # Frees the slot of a discarded instance, handing it to the first
+      # waiter if there is one.
+      def vacate
+        @checkout_lock.synchronize do
+          if @size <= @max_size && waiter = next_waiter
+            waiter.grant(:create)
+          else
+            @size -= 1
+          end
+        end
+      end
+
+      def forget(entry)
+        entry.retire
+        @checkout_lock.synchronize { @entries.delete(entry) }
+        entry.instance.instance_variable_set(:@__pool, nil)
+        entry.instance.instance_variable_set(:@__pool_entry, nil)
+      end
+
+      def discard(entry)
+        @checkout_lock.synchronize { @entries.delete(entry) }
+        entry.instance.dispose
+        release_slot(entry.slot)
+        vacate
       end
 
     end
@@ -0,0 +1,115 @@
+module DataObjects
+  module Pooling
+
+    # ==== Notes
+    # Adjusts the size of a pool to what it actually needs, one step per
+    # scavenger run. The pool grows while checkouts had to wait, as long as
+    # the query latency measured by its ConcurrencyLimiter (if any) stays
+    # close to the lowest latency seen. A slower database means more
+    # connections would only add to its load. The pool shrinks when nobody
+    # waited, and on average less than the shrink utilization of it was in
+    # use over the last few runs.
+    #
+    # Every decision is logged to DataObjects.logger and kept in #decisions.
+    #
+    # Options:
+    # min_size::           The pool never shrinks below this (1)
+    # max_size::           The pool never grows beyond this (32)
+    # step::               Instances added or removed at a time (1)
+    # latency_tolerance::  Latency up to this factor of the lowest one counts as flat (1.5)
+    # shrink_utilization:: Share of the pool in use on average below which it shrinks (0.5)
+    # samples::            Runs the utilization is averaged over before shrinking (3)
+    # min_wait_time::      Seconds checkouts have to wait in all since the last run to grow (0)
+    class AutoSizer
+
+      MAX_DECISIONS = 100
+
+      # The most recent resize decisions, oldest first. Each is a Hash with
+      # :at, :from, :to and :reason.
+      attr_reader :decisions
+
+      def initialize(options = {})
+        @min_size           = options[:min_size] || 1
+        @max_size           = options[:max_size] || 32
+        @step               = options[:step] || 1
+        @latency_tolerance  = options[:latency_tolerance] || 1.5
+        @shrink_utilization = options[:shrink_utilization] || 0.5
+        @samples            = options[:samples] || 3
+        @min_wait_time      = options[:min_wait_time] || 0
+
+        @decisions   = []
+        @pool        = nil
+        @baseline    = nil
+        start_over(nil)
+      end
+
+      def adjust(pool)
+        stats = pool.stats
+
+        # The counters start over in a new pool, and in a pool reset after
+        # a fork
+        start_over(pool) if !pool.equal?(@pool) || stats[:waits] < @last_waits || stats[:wait_time] < @last_wait_time
+
+        new_waits       = stats[:waits] - @last_waits
+        new_wait_time   = stats[:wait_time] - @last_wait_time
+        @last_waits     = stats[:waits]
+        @last_wait_time = stats[:wait_time]
+
+        size    = pool.max_size
+        latency = pool.concurrency_limiter && pool.concurrency_limiter.latency
+
+        @utilization << pool.used.size.to_f / size
+        @utilization.shift if @utilization.size > @samples
+        utilization = @utilization.inject(0) { |sum, sample| sum + sample } / @utilization.size
+
+        if new_waits > 0 && new_wait_time >= @min_wait_time && size < @max_size && latency_flat?(latency)
+          resize(pool, [size + @step, @max_size].min, "#{new_waits} checkouts waited #{'%.3f' % new_wait_time}s")
+        elsif new_waits == 0 && size > @min_size && @utilization.size >= @samples && utilization < @shrink_utilization
+          resize(pool, [size - @step, @min_size].max, "#{'%.0f' % (utilization * 100)}% of #{size} in use on average")
+        end
+
+        track_baseline(latency)
+      end
+
+      private
+
+      def start_over(pool)
+        @pool           = pool
+        @last_waits     = 0
+        @last_wait_time = 0.0
+        @utilization    = []
+      end
+
+      def latency_flat?(latency)
+        latency.nil? || @baseline.nil? || latency <= @baseline * @latency_tolerance
+      end
+
+      # Follows drops in latency right away and rises slowly, so a baseline
+      # from a quiet moment doesn't block growth forever.
+      def track_baseline(latency)
+        return if latency.nil?
+        @baseline = if @baseline.nil? || latency < @baseline
+          latency
+        else
+          @baseline + (latency - @baseline) * 0.05
+        end
+      end
+
+      def resize(pool, size, reason)
+        decision = { :at => Time.now, :from => pool.max_size, :to => size, :reason => reason }
+        pool.resize(size)
+        # The samples were taken at the old size
+        @utilization.clear
+
+        @decisions << decision
+        @decisions.shift if @decisions.size > MAX_DECISIONS
+
+        if DataObjects.logger
+          DataObjects.logger.info("Resized #{pool.inspect} from #{decision[:from]} to #{size}: #{reason}")
+        end
+      end
+
+    end
+
+  end
+end
@@ -0,0 +1,105 @@
+require 'digest/sha1'
+require 'tmpdir'
+
+module DataObjects
+  module Pooling
+
+    # ==== Notes
+    # Caps the number of instances of a pool across all processes on a host,
+    # like the workers of a preforking server that share one database.
+    #
+    # Every instance holds an exclusive lock on one of +max+ slot files that
+    # are shared by all processes using the same key. The kernel drops the
+    # locks of a process when it dies, so the slots of a crashed worker are
+    # available again without any cleanup.
+    #
+    # Create the limit before forking. Children open the slot files again on
+    # first use, as the descriptors inherited from the parent share its locks.
+    class GlobalLimit
+
+      attr_reader :max
+
+      def initialize(key, max, directory = Dir.tmpdir)
+        raise ArgumentError.new("+max+ should be a positive Integer but was #{max.inspect}") unless Integer === max && max > 0
+
+        @max    = max
+        @prefix = File.join(directory, "data_objects-#{Digest::SHA1.hexdigest(key.to_s)}")
+        @lock   = Mutex.new
+        open_slots
+      end
+
+      # Returns the acquired slot, or nil if none became available within
+      # +timeout+ seconds. Waits forever when +timeout+ is nil. Slots are
+      # polled, so processes aren't served in strict arrival order.
+      def acquire(timeout = nil)
+        deadline = Time.now + timeout if timeout
+        delay    = 0.001
+
+        loop do
+          slot = try_acquire
+          return slot if slot
+
+          if deadline
+            remaining = deadline - Time.now
+            return nil if remaining <= 0
+            delay = remaining if delay > remaining
+          end
+
+          sleep(delay)
+          delay = [delay * 2, 0.1].min
+        end
+      end
+
+      def release(slot)
+        @lock.synchronize do
+          return if @pid != Process.pid || !@held.delete?(slot)
+          @slots[slot].flock(File::LOCK_UN)
+        end
+        nil
+      end
+
+      # Number of slots held by this process.
+      def held
+        @held.size
+      end
+
+      def reset_after_fork
+        @lock.synchronize { reopen if @pid != Process.pid }
+      end
+
+      private
+
+      def try_acquire
+        @lock.synchronize do
+          reopen if @pid != Process.pid
+
+          @slots.each_with_index do |file, slot|
+            next if @held.include?(slot)
+            if file.flock(File::LOCK_EX | File::LOCK_NB)
+              @held << slot
+              return slot
+            end
+          end
+          nil
+        end
+      end
+
+      def open_slots
+        @pid   = Process.pid
+        @held  = Set.new
+        @slots = Array.new(@max) do |slot|
+          File.open("#{@prefix}.#{slot}.lock", File::RDWR | File::CREAT, 0600)
+        end
+      end
+
+      # Closing the inherited descriptors leaves the locks of the parent
+      # alone, unlike unlocking them.
+      def reopen
+        @slots.each { |file| file.close }
+        open_slots
+      end
+
+    end
+
+  end
+end
@@ -0,0 +1,252 @@
+module DataObjects
+  module Pooling
+
+    # ==== Notes
+    # A stand-in for a Connection that only checks out a pooled connection
+    # while a statement runs, like the transaction pooling of pgbouncer. A
+    # request can hold on to it for as long as it likes, the pool only needs
+    # as many connections as there are statements running at a time. See
+    # DataObjects::Connection.new with :multiplex.
+    #
+    # The pooled connection is pinned to the proxy while there's session
+    # state on it: from BEGIN or START TRANSACTION up to COMMIT or ROLLBACK,
+    # while a Reader is still open, and inside #pin. Other session state,
+    # like SET, temporary tables or SQLite memory databases, isn't noticed.
+    # Use #pin for that.
+    class MultiplexedConnection
+
+      TRANSACTION_START = /\A\s*(?:BEGIN|START\s+TRANSACTION)\b/i
+      TRANSACTION_END   = /\A\s*(?:COMMIT|END|ROLLBACK(?!\s+TO\b)|PREPARE\s+TRANSACTION)\b/i
+
+      def initialize(spec, priority = nil)
+        @spec, @priority = spec, priority
+        @connection      = nil
+        @readers         = []
+        @pins            = 0
+        @in_transaction  = false
+        @query_timeout   = nil
+      end
+
+      def to_s
+        @spec.uri.to_s
+      end
+
+      def create_command(text)
+        MultiplexedCommand.new(self, text)
+      end
+
+      # Whether a pooled connection is checked out right now.
+      def pinned?
+        !@connection.nil?
+      end
+
+      def in_transaction?
+        @in_transaction
+      end
+
+      # The timeout for statements of the proxy, see Connection#query_timeout.
+      # It's kept here and set on every connection checked out, as a pooled
+      # connection forgets it when released.
+      def query_timeout
+        return @query_timeout if @query_timeout
+        query = @spec.uri.query if @spec.uri.respond_to?(:query)
+        query['query_timeout'].to_f if Hash === query && query['query_timeout']
+      end
+
+      def query_timeout=(seconds)
+        @query_timeout = seconds
+        @connection.query_timeout = seconds if @connection
+      end
+
+      # Keeps the same pooled connection for every statement in the block,
+      # and yields it.
+      def pin
+        connection = checkout
+        @pins += 1
+        begin
+          yield connection
+        ensure
+          @pins -= 1
+          checkin
+        end
+      end
+
+      # Closes open readers and gives the pinned connection back. One with
+      # a transaction still open is disposed of instead, as it can't be
+      # handed to anyone else.
+      def close
+        @readers.dup.each { |reader| reader.close }
+        return nil unless connection = @connection
+
+        @connection, @pins = nil, 0
+        if @in_transaction
+          @in_transaction = false
+          connection.detach
+          connection.dispose
+        else
+          connection.release
+        end
+        nil
+      end
+      alias release close
+      alias dispose close
+
+      # Anything else a Connection does runs on a pooled connection too.
+      def method_missing(name, *args, &block)
+        return super unless @spec.driver_class.method_defined?(name)
+
+        checkout
+        begin
+          @connection.__send__(name, *args, &block)
+        ensure
+          checkin
+        end
+      end
+
+      def respond_to?(name, include_private = false)
+        super || @spec.driver_class.method_defined?(name)
+      end
+
+      private
+
+      def execute_non_query(command, args)
+        run(command) { |prepared| prepared.execute_non_query(*args) }
+      end
+
+      def execute_reader(command, args)
+        run(command) do |prepared|
+          reader = PinnedReader.new(self, prepared.execute_reader(*args))
+          @readers << reader
+          reader
+        end
+      end
+
+      def run(command)
+        checkout
+        begin
+          result = yield command.prepare(@connection)
+          text   = command.to_s
+
+          if text =~ TRANSACTION_START
+            @in_transaction = true
+          elsif text =~ TRANSACTION_END
+            @in_transaction = false
+          end
+          result
+        ensure
+          checkin
+        end
+      end
+
+      def reader_closed(reader)
+        checkin if @readers.delete(reader)
+      end
+
+      def checkout
+        return @connection if @connection
+
+        @connection = @spec.connect(@priority)
+        @connection.query_timeout = @query_timeout if @query_timeout
+        @connection
+      end
+
+      def checkin
+        return if @connection.nil? || @in_transaction || @pins > 0 || !@readers.empty?
+
+        connection, @connection = @connection, nil
+        connection.release
+      end
+
+    end
+
+    # The Command of a MultiplexedConnection, or of any other proxy that
+    # implements the private execute_non_query and execute_reader, which get
+    # the command and its bind values. It's only turned into a Command of the
+    # driver once it's executed, see #prepare.
+    #
+    # There's no send_reader or send_non_query: the pooled connection is
+    # given back once the statement is done, so there'd be nothing to pick
+    # the result up from with get_result.
+    class MultiplexedCommand
+
+      attr_reader :connection
+
+      def initialize(connection, text)
+        @connection, @text = connection, text
+        @types   = nil
+        @timeout = nil
+      end
+
+      def execute_non_query(*args)
+        @connection.send(:execute_non_query, self, args)
+      end
+
+      def execute_reader(*args)
+        @connection.send(:execute_reader, self, args)
+      end
+
+      def send_reader(*args)
+        raise NotImplementedError.new("#{self.class} only runs statements with execute_reader and execute_non_query")
+      end
+      alias send_non_query send_reader
+
+      def set_types(*column_types)
+        @types = column_types
+      end
+
+      # See DataObjects::Command#timeout.
+      attr_writer :timeout
+
+      def timeout
+        @timeout || (@connection.query_timeout if @connection.respond_to?(:query_timeout))
+      end
+
+      # Creates the Command to run this one as on connection, with the same
+      # types and timeout.
+      def prepare(connection)
+        command = connection.create_command(@text)
+        command.set_types(*@types) if @types
+        command.timeout = @timeout if @timeout
+        command
+      end
+
+      def to_s
+        @text
+      end
+
+    end
+
+    # Keeps the connection of a MultiplexedConnection pinned until it's
+    # closed.
+    class PinnedReader < DataObjects::Reader
+
+      def initialize(connection, reader)
+        @connection, @reader = connection, reader
+      end
+
+      def fields
+        @reader.fields
+      end
+
+      def values
+        @reader.values
+      end
+
+      def next!
+        @reader.next!
+      end
+
+      def field_count
+        @reader.field_count
+      end
+
+      def close
+        @reader.close
+      ensure
+        @connection.send(:reader_closed, self)
+      end
+
+    end
+
+  end
+end
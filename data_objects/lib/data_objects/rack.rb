@@ -0,0 +1,73 @@
+require 'data_objects'
+
+module DataObjects
+  # ==== Notes
+  # Rack middleware that wraps every request in DataObjects.with_connection,
+  # so the request checks out at most one connection per URI and releases
+  # it once the response body is closed.
+  #
+  # ==== Examples
+  #   require 'data_objects/rack'
+  #
+  #   use DataObjects::Rack, 'postgres://localhost/app'
+  class Rack
+
+    def initialize(app, *uris)
+      @app, @uris = app, uris
+    end
+
+    def call(env)
+      @uris.each { |uri_s| Connection.enter_sticky(uri_s) }
+      begin
+        status, headers, body = @app.call(env)
+      rescue Exception
+        leave
+        raise
+      end
+      [status, headers, Body.new(body) { leave }]
+    end
+
+    private
+
+    def leave
+      @uris.each { |uri_s| Connection.leave_sticky(uri_s) }
+    end
+
+    # Calls the block once the body is closed, like Rack::BodyProxy.
+    class Body
+
+      def initialize(body, &block)
+        @body, @block = body, block
+        @closed = false
+      end
+
+      def each(&block)
+        @body.each(&block)
+      end
+
+      def close
+        return if @closed
+        @closed = true
+        begin
+          @body.close if @body.respond_to?(:close)
+        ensure
+          @block.call
+        end
+      end
+
+      def closed?
+        @closed
+      end
+
+      def respond_to?(name, include_private = false)
+        super || @body.respond_to?(name, include_private)
+      end
+
+      def method_missing(name, *args, &block)
+        @body.__send__(name, *args, &block)
+      end
+
+    end
+
+  end
+end
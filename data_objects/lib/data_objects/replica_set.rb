@@ -0,0 +1,294 @@
+module DataObjects
+
+  # ==== Notes
+  # A primary database with streaming replicas. Connections of the set send
+  # reads outside of transactions to a healthy replica, picked round robin
+  # or by least latency, and everything else to the primary. For a short
+  # window after a write, reads go to the primary too, so they see their
+  # own writes. Writes are tracked per thread and primary URI, so this holds
+  # for every connection the thread gets from a set with that primary.
+  #
+  # Replicas are checked in a background thread. One that can't be reached,
+  # or lags behind the primary by more than :max_lag seconds, is skipped
+  # until a later check finds it healthy again, and is logged as such. Lag
+  # is measured with pg_last_xact_replay_timestamp() on PostgreSQL, or 0
+  # once the replica replayed all it received, and with SHOW SLAVE STATUS on
+  # MySQL; other
+  # databases are only checked for being reachable, unless a :lag_query is
+  # given which returns the lag in seconds.
+  #
+  # Only SELECT, SHOW and EXPLAIN go to replicas, and no SELECT ... FOR
+  # UPDATE. Reads with side effects, like SELECT nextval('widgets_id_seq'),
+  # should be run on the primary connection explicitly.
+  #
+  # ==== Examples
+  #   replicas = DataObjects::ReplicaSet.new('postgres://db1/app',
+  #     ['postgres://db2/app', 'postgres://db3/app'], :strategy => :least_latency)
+  #
+  #   connection = replicas.connection
+  #   connection.create_command('SELECT * FROM widgets').execute_reader  # db2 or db3
+  #   connection.create_command('DELETE FROM widgets').execute_non_query # db1
+  class ReplicaSet
+
+    STRATEGIES = [ :round_robin, :least_latency ]
+
+    LAG_QUERIES = {
+      # The replay timestamp doesn't move while the primary is idle
+      'postgres' => 'SELECT CASE WHEN pg_last_wal_receive_lsn() = pg_last_wal_replay_lsn() THEN 0 ' \
+                    'ELSE COALESCE(EXTRACT(EPOCH FROM now() - pg_last_xact_replay_timestamp()), 0) END',
+      'mysql'    => 'SHOW SLAVE STATUS'
+    }
+
+    # PostgreSQL before 10 named the WAL functions after the xlog
+    POSTGRES_9_LAG_QUERY = 'SELECT CASE WHEN pg_last_xlog_receive_location() = pg_last_xlog_replay_location() THEN 0 ' \
+                           'ELSE COALESCE(EXTRACT(EPOCH FROM now() - pg_last_xact_replay_timestamp()), 0) END'
+
+    # The column of SHOW SLAVE STATUS with the lag
+    LAG_FIELD = 'Seconds_Behind_Master'
+
+    READ     = /\A\s*(?:SELECT|SHOW|EXPLAIN)\b/i
+    LOCKING  = /\bFOR\s+(?:UPDATE|SHARE)\b|\bLOCK\s+IN\s+SHARE\s+MODE\b/i
+
+    # A replica and what the set knows about it.
+    class Replica
+      attr_reader :spec, :latency, :lag, :error
+
+      # The server_version_num of a PostgreSQL replica, once it's known
+      attr_accessor :server_version
+
+      def initialize(spec)
+        @spec    = spec
+        @healthy = true
+        @latency = nil
+        @lag     = nil
+        @error   = nil
+        @server_version = nil
+      end
+
+      def healthy?
+        @healthy
+      end
+
+      # Keeps a moving average of the response time.
+      def record(seconds)
+        @latency = @latency.nil? ? seconds : @latency * 0.8 + seconds * 0.2
+      end
+
+      def mark(healthy, lag = nil, error = nil)
+        @healthy, @lag, @error = healthy, lag, error
+      end
+
+      def inspect
+        "#<DataObjects::ReplicaSet::Replica #{@spec.uri} healthy=#{@healthy} lag=#{@lag.inspect} latency=#{@latency.inspect}>"
+      end
+    end
+
+    attr_reader :primary, :replicas, :strategy, :write_window, :max_lag, :check_interval
+
+    # ==== Options
+    # :strategy::       :round_robin (the default) or :least_latency
+    # :write_window::   seconds to read from the primary after a write, 2 by default
+    # :max_lag::        seconds a replica may lag behind, 10 by default
+    # :check_interval:: seconds between health checks, 5 by default, nil for none
+    # :lag_query::      SQL returning the lag of a replica in seconds
+    def initialize(primary_uri, replica_uris, options = {})
+      @primary  = DataObjects::Connection.spec(primary_uri)
+      @replicas = replica_uris.map { |uri_s| Replica.new(DataObjects::Connection.spec(uri_s)) }
+      raise ArgumentError.new("+primary_uri+ should be a pooled connection URI but was #{primary_uri.inspect}") unless @primary.pooled?
+
+      @strategy = options[:strategy] || :round_robin
+      raise ArgumentError.new("+strategy+ should be one of #{STRATEGIES.inspect} but was #{@strategy.inspect}") unless STRATEGIES.include?(@strategy)
+
+      @write_window   = options.fetch(:write_window, 2)
+      @max_lag        = options.fetch(:max_lag, 10)
+      @check_interval = options.fetch(:check_interval, 5)
+      @driver         = @primary.driver_class.name.split('::')[-2].downcase
+      @lag_query      = options[:lag_query] || LAG_QUERIES[@driver]
+      @postgres_lag   = options[:lag_query].nil? && @driver == 'postgres'
+
+      @lock    = Mutex.new
+      @next    = 0
+      @checker = nil
+    end
+
+    # A new RoutingConnection for this set.
+    def connection
+      RoutingConnection.new(self)
+    end
+
+    # Picks a healthy replica to read from, nil if there's none.
+    def replica
+      start_checker if @check_interval
+
+      healthy = @replicas.select { |replica| replica.healthy? }
+      return nil if healthy.empty?
+
+      if @strategy == :least_latency
+        healthy.min_by { |replica| replica.latency || 0 }
+      else
+        @lock.synchronize { healthy[(@next += 1) % healthy.size] }
+      end
+    end
+
+    # Notes a write by the current thread.
+    def wrote
+      (Thread.current[:__data_objects_writes] ||= {})[@primary.uri.to_s] = Time.now
+    end
+
+    # Whether the current thread wrote to the primary within the last
+    # +write_window+ seconds.
+    def reading_own_writes?
+      return false unless writes = Thread.current[:__data_objects_writes]
+
+      last_write = writes[@primary.uri.to_s]
+      !last_write.nil? && Time.now - last_write < @write_window
+    end
+
+    # Checks every replica once.
+    def check_health
+      @replicas.each { |replica| check(replica) }
+    end
+
+    # Stops the background health checks.
+    def stop
+      @checker.kill if @checker
+      @checker = nil
+    end
+
+    private
+
+    def check(replica)
+      connection = replica.spec.connect
+      query      = @postgres_lag ? postgres_lag_query(replica, connection) : @lag_query
+      started    = Time.now
+      reader     = connection.create_command(query || 'SELECT 1').execute_reader
+      lag        = query.nil? ? 0 : (reader.next! ? lag_of(reader) : 0)
+      reader.close
+      replica.record(Time.now - started)
+      replica.mark(!lag.nil? && lag <= @max_lag, lag)
+    rescue StandardError => e
+      if replica.healthy? && DataObjects.logger
+        DataObjects.logger.warn("Replica #{replica.spec.uri} failed its health check: #{e.class}: #{e.message}")
+      end
+      replica.mark(false, nil, e)
+    ensure
+      connection.close if connection
+    end
+
+    # The lag query for the version of the replica, which is looked up on
+    # the first check.
+    def postgres_lag_query(replica, connection)
+      replica.server_version ||= begin
+        reader = connection.create_command('SHOW server_version_num').execute_reader
+        reader.next! ? reader.values.first.to_i : 0
+      ensure
+        reader.close if reader
+      end
+
+      replica.server_version < 100000 ? POSTGRES_9_LAG_QUERY : LAG_QUERIES['postgres']
+    end
+
+    # The lag of the current row, nil when it isn't known (replication is
+    # stopped on MySQL).
+    def lag_of(reader)
+      value = reader.values[reader.fields.index(LAG_FIELD) || 0]
+      value.nil? ? nil : value.to_f
+    end
+
+    def start_checker
+      return if @checker && @checker.alive?
+
+      @lock.synchronize do
+        return if @checker && @checker.alive?
+
+        @checker = Thread.new do
+          until DataObjects.exiting
+            check_health
+            sleep @check_interval
+          end
+        end
+      end
+    end
+
+    # ==== Notes
+    # A Connection that routes every statement to the primary or a replica
+    # of its ReplicaSet. Connections to each database are multiplexed, see
+    # DataObjects::Pooling::MultiplexedConnection, so a transaction or an
+    # open reader keeps its connection.
+    class RoutingConnection
+
+      def initialize(replica_set)
+        @replica_set = replica_set
+        @primary     = Pooling::MultiplexedConnection.new(replica_set.primary)
+        @replicas    = {}
+      end
+
+      # The connection to the primary, for statements that have to run
+      # there.
+      attr_reader :primary
+
+      def to_s
+        @primary.to_s
+      end
+
+      def create_command(text)
+        Pooling::MultiplexedCommand.new(self, text)
+      end
+
+      def in_transaction?
+        @primary.in_transaction?
+      end
+
+      # Whether reads go to the primary because of a recent write.
+      def reading_own_writes?
+        @replica_set.reading_own_writes?
+      end
+
+      def close
+        @primary.close
+        @replicas.each_value { |connection| connection.close }
+        nil
+      end
+      alias release close
+      alias dispose close
+
+      private
+
+      def execute_non_query(command, args)
+        @replica_set.wrote
+        command.prepare(@primary).execute_non_query(*args)
+      end
+
+      def execute_reader(command, args)
+        text = command.to_s
+
+        if replica = read_replica(text)
+          begin
+            started = Time.now
+            reader  = command.prepare(replica_connection(replica)).execute_reader(*args)
+            replica.record(Time.now - started)
+            return reader
+          rescue DataObjects::ConnectionError => e
+            replica.mark(false, nil, e)
+          end
+        end
+
+        @replica_set.wrote unless text =~ READ
+        command.prepare(@primary).execute_reader(*args)
+      end
+
+      def read_replica(text)
+        return nil if in_transaction? || reading_own_writes?
+        return nil unless text =~ READ && text !~ LOCKING
+
+        @replica_set.replica
+      end
+
+      def replica_connection(replica)
+        @replicas[replica] ||= Pooling::MultiplexedConnection.new(replica.spec)
+      end
+
+    end
+
+  end
+end
@@ -0,0 +1,280 @@
+require 'zlib'
+
+module DataObjects
+
+  # ==== Notes
+  # Spreads a database over several shards, each with its own URI and so
+  # its own pool. Keys are mapped to shards either by hash, when the shards
+  # are given as an Array of URIs, or by range, when they're given as a Hash
+  # of Range => URI.
+  #
+  # A command with a shard key runs on the shard of that key, and a read
+  # returns the Reader of that shard. A read without a key runs on every
+  # shard in parallel, and the results are merged into a
+  # single Reader: one shard after the other, or sorted when the command has
+  # an :order_by. Writes without a key need :all => true, and run on every
+  # shard one after the other.
+  #
+  # ==== Examples
+  #   router = DataObjects::ShardRouter.new(['postgres://db1/app', 'postgres://db2/app'])
+  #
+  #   router.create_command('SELECT * FROM orders WHERE tenant_id = ?', :key => 42).execute_reader(42)
+  #   router.create_command('SELECT * FROM orders ORDER BY placed_at DESC', :order_by => 'placed_at DESC').execute_reader
+  #
+  #   router = DataObjects::ShardRouter.new(0...1000 => 'postgres://db1/app', 1000..1_000_000 => 'postgres://db2/app')
+  class ShardRouter
+
+    # The URIs of the shards
+    attr_reader :shards
+
+    def initialize(shards)
+      if Hash === shards
+        @ranges = shards.to_a.sort_by { |range, uri| range.first }
+        @shards = @ranges.map { |range, uri| uri }
+      else
+        @ranges = nil
+        @shards = shards.dup
+      end
+      raise ArgumentError.new("+shards+ should not be empty") if @shards.empty?
+      @shards.each { |uri| DataObjects::Connection.spec(uri) }
+    end
+
+    # The URI of the shard the key lives on.
+    def shard_for(key)
+      return @shards[Zlib.crc32(key.to_s) % @shards.size] if @ranges.nil?
+
+      range, uri = @ranges.find { |range, uri| range.include?(key) }
+      raise ArgumentError.new("No shard for key #{key.inspect}") if uri.nil?
+      uri
+    end
+
+    # A connection to the shard of the key, for transactions on that shard.
+    # Close it when done.
+    def connection(key)
+      DataObjects::Connection.new(shard_for(key))
+    end
+
+    # ==== Options
+    # :key::      the shard key, to run the command on its shard only
+    # :order_by:: a column, or an Array of columns, with an optional DESC,
+    #             to merge the rows of all shards by
+    # :all::      true to run a write on every shard
+    def create_command(text, options = {})
+      Command.new(self, text, options)
+    end
+
+    # A command of a ShardRouter.
+    class Command
+
+      attr_reader :router
+
+      def initialize(router, text, options)
+        @router, @text = router, text
+        @key      = options[:key]
+        @order_by = options[:order_by]
+        @all      = options[:all]
+        @types    = nil
+        @timeout  = nil
+      end
+
+      def execute_non_query(*args)
+        unless @key.nil?
+          return run(@router.shard_for(@key)) { |command| command.execute_non_query(*args) }
+        end
+        raise ArgumentError.new("A write without a shard key only runs on every shard with :all => true") unless @all
+
+        affected = @router.shards.inject(0) do |sum, uri|
+          sum + run(uri) { |command| command.execute_non_query(*args) }.affected_rows
+        end
+        DataObjects::Result.new(self, affected)
+      end
+
+      def execute_reader(*args)
+        return shard_reader(@router.shard_for(@key), args) unless @key.nil?
+
+        threads = @router.shards.map do |uri|
+          Thread.new do
+            begin
+              connection = DataObjects::Connection.new(uri)
+              [ connection, prepare(connection).execute_reader(*args) ]
+            rescue Exception => e
+              connection.close if connection
+              e
+            end
+          end
+        end
+        parts = threads.map { |thread| thread.value }
+
+        if error = parts.find { |part| Exception === part }
+          (parts - [ error ]).each do |part|
+            next if Exception === part
+            part[1].close
+            part[0].close
+          end
+          raise error
+        end
+
+        MergedReader.new(parts, @order_by)
+      end
+
+      # Every shard runs the command on a connection of its own, given back
+      # before there's a result to pick up with get_result.
+      def send_reader(*args)
+        raise NotImplementedError.new("#{self.class} only runs statements with execute_reader and execute_non_query")
+      end
+      alias send_non_query send_reader
+
+      def set_types(*column_types)
+        @types = column_types
+      end
+
+      # Seconds the command may run on each shard, see
+      # DataObjects::Command#timeout. Without one, the query_timeout of the
+      # shard URIs applies.
+      attr_accessor :timeout
+
+      def to_s
+        @text
+      end
+
+      private
+
+      def shard_reader(uri, args)
+        connection = DataObjects::Connection.new(uri)
+        reader     = prepare(connection).execute_reader(*args)
+        reader.extend(ConnectionClosingReader)
+        reader.instance_variable_set(:@__shard_connection, connection)
+        reader
+      rescue Exception
+        connection.close if connection
+        raise
+      end
+
+      def run(uri)
+        connection = DataObjects::Connection.new(uri)
+        begin
+          yield prepare(connection)
+        ensure
+          connection.close
+        end
+      end
+
+      def prepare(connection)
+        command = connection.create_command(@text)
+        command.set_types(*@types) if @types
+        command.timeout = @timeout if @timeout
+        command
+      end
+
+    end
+
+    # Extends the Reader of a command with a shard key, to close its
+    # connection with it.
+    module ConnectionClosingReader
+      def close
+        super
+      ensure
+        connection, @__shard_connection = @__shard_connection, nil
+        connection.close if connection
+      end
+    end
+
+    # ==== Notes
+    # The Reader of a command that ran on several shards. Without an order
+    # it returns the rows of one shard after the other. With one, it merges
+    # the rows of all shards, which should have been sorted the same way by
+    # the query. NULLs sort as on PostgreSQL: last, or first with DESC.
+    #
+    # Closing the reader closes the readers and connections of all shards.
+    class MergedReader < DataObjects::Reader
+
+      def initialize(parts, order_by = nil)
+        @connections = parts.map { |connection, reader| connection }
+        @readers     = parts.map { |connection, reader| reader }
+        @order_by    = order_by && Array(order_by).map { |column| column.to_s.split(/\s+/) }
+        @current     = nil
+        @index       = 0
+        @heads       = nil
+        @closed      = false
+      end
+
+      def fields
+        @readers.first.fields
+      end
+
+      def field_count
+        @readers.first.field_count
+      end
+
+      def values
+        raise DataObjects::DataError.new("Reader is not initialized") if @current.nil?
+        @current
+      end
+
+      def next!
+        @current = @order_by ? next_merged : next_concatenated
+        !@current.nil?
+      end
+
+      def close
+        return false if @closed
+        @closed = true
+        @readers.each { |reader| reader.close }
+        @connections.each { |connection| connection.close }
+        true
+      end
+
+      private
+
+      def next_concatenated
+        while reader = @readers[@index]
+          return reader.values if reader.next!
+          @index += 1
+        end
+        nil
+      end
+
+      # Takes the smallest of the current rows of the shards, and moves the
+      # shard it came from on by one row.
+      def next_merged
+        if @heads.nil?
+          @columns = @order_by.map do |column, direction|
+            index = fields.index(column)
+            raise ArgumentError.new("Unknown column #{column.inspect} in :order_by") if index.nil?
+            [ index, direction.to_s.upcase == 'DESC' ? -1 : 1 ]
+          end
+          @heads = @readers.map { |reader| reader.next! ? reader.values : nil }
+        end
+
+        smallest = nil
+        @heads.each_with_index do |row, index|
+          next if row.nil?
+          smallest = index if smallest.nil? || compare(row, @heads[smallest]) < 0
+        end
+        return nil if smallest.nil?
+
+        row    = @heads[smallest]
+        reader = @readers[smallest]
+        @heads[smallest] = reader.next! ? reader.values : nil
+        row
+      end
+
+      def compare(a, b)
+        @columns.each do |index, direction|
+          x, y = a[index], b[index]
+          order = if x.nil? || y.nil?
+            ((x.nil? ? 1 : 0) - (y.nil? ? 1 : 0)) * direction
+          else
+            order = x <=> y
+            raise ArgumentError.new("Can't merge #{x.inspect} and #{y.inspect} in :order_by, they don't compare") if order.nil?
+            order * direction
+          end
+          return order unless order == 0
+        end
+        0
+      end
+
+    end
+
+  end
+end
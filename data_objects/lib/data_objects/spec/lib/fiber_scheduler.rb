@@ -0,0 +1,119 @@
+module DataObjects::Spec
+  # A minimal Fiber scheduler built on IO.select, enough to check that the
+  # drivers only block the current fiber. Set it in a thread of its own:
+  # the fibers scheduled there all run by the time the thread is done.
+  #
+  #   Thread.new do
+  #     Fiber.set_scheduler(DataObjects::Spec::FiberScheduler.new)
+  #     Fiber.schedule { ... }
+  #   end.join
+  class FiberScheduler
+    def initialize
+      @readable = {}
+      @writable = {}
+      @waiting  = {}
+      @blocked  = 0
+      @ready    = []
+      @lock     = Mutex.new
+      @urgent   = IO.pipe
+    end
+
+    def run
+      while @readable.any? || @writable.any? || @waiting.any? || @blocked > 0 || ready?
+        readable, writable = IO.select(@readable.keys + [@urgent.first], @writable.keys, [], next_timeout)
+        selected = {}
+
+        Array(readable).each do |io|
+          if io == @urgent.first
+            io.read_nonblock(1024, :exception => false)
+          elsif (fiber = @readable[io])
+            selected[fiber] = IO::READABLE
+          end
+        end
+
+        Array(writable).each do |io|
+          if (fiber = @writable[io])
+            selected[fiber] = selected.fetch(fiber, 0) | IO::WRITABLE
+          end
+        end
+
+        selected.each { |fiber, events| fiber.resume(events) if fiber.alive? }
+
+        now = monotonic
+        @waiting.select { |_, time| time <= now }.each_key do |fiber|
+          @waiting.delete(fiber)
+          fiber.resume if fiber.alive?
+        end
+
+        ready = @lock.synchronize { @ready.slice!(0..-1) }
+        ready.each { |fiber| fiber.resume if fiber.alive? }
+      end
+    end
+
+    def close
+      run
+    ensure
+      @urgent.each { |io| io.close }
+    end
+
+    def fiber(&block)
+      fiber = Fiber.new(:blocking => false, &block)
+      fiber.resume
+      fiber
+    end
+
+    # Returns the events that happened, or nil when the timeout passed first
+    def io_wait(io, events, timeout)
+      fiber = Fiber.current
+      @readable[io] = fiber if events & IO::READABLE != 0
+      @writable[io] = fiber if events & IO::WRITABLE != 0
+      @waiting[fiber] = monotonic + timeout if timeout
+      Fiber.yield
+    ensure
+      @readable.delete(io) if @readable[io] == fiber
+      @writable.delete(io) if @writable[io] == fiber
+      @waiting.delete(fiber)
+    end
+
+    def kernel_sleep(duration = nil)
+      block(:sleep, duration)
+    end
+
+    def block(blocker, timeout = nil)
+      fiber = Fiber.current
+
+      if timeout
+        @waiting[fiber] = monotonic + timeout
+      else
+        @blocked += 1
+      end
+
+      begin
+        Fiber.yield
+      ensure
+        timeout ? @waiting.delete(fiber) : @blocked -= 1
+      end
+    end
+
+    def unblock(blocker, fiber)
+      @lock.synchronize { @ready << fiber }
+      @urgent.last.write_nonblock('.', :exception => false)
+    end
+
+    private
+
+    def ready?
+      @lock.synchronize { @ready.any? }
+    end
+
+    def next_timeout
+      return 0 if ready?
+      time = @waiting.values.min
+      time && [time - monotonic, 0].max
+    end
+
+    def monotonic
+      Process.clock_gettime(Process::CLOCK_MONOTONIC)
+    end
+  end
+end
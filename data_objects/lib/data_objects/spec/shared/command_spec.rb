@@ -231,3 +231,237 @@ shared_examples_for 'a Command with async' do
 
   end
 end
+
+shared_examples_for 'a Command with execute_readers' do
+
+  before :all do
+    setup_test_environment
+  end
+
+  describe 'execute_readers' do
+
+    before do
+      @connections = (1..4).map { DataObjects::Connection.new(CONFIG.uri) }
+      @commands    = @connections.map { |connection| connection.create_command(CONFIG.sleep) }
+    end
+
+    after do
+      @connections.each { |connection| connection.close }
+    end
+
+    it 'should run the commands in parallel without threads' do
+      start   = Time.now
+      readers = described_class.execute_readers(*@commands)
+      (Time.now - start).should < 2
+      readers.size.should == 4
+      readers.each { |reader| reader.close }
+    end
+
+    it 'should yield every command with its reader' do
+      yielded = []
+      described_class.execute_readers(*@commands) do |command, reader|
+        yielded << command
+        reader.close
+      end
+      yielded.size.should == 4
+      (@commands - yielded).should be_empty
+    end
+
+    it 'should take bind values along with a command' do
+      command = @connections.first.create_command('SELECT ?')
+      reader  = described_class.execute_readers([command, 1]).first
+      reader.next!
+      reader.values.should == [1]
+      reader.close
+    end
+
+    it 'should refuse two commands on the same connection' do
+      other = @connections.first.create_command(CONFIG.sleep)
+      expect { described_class.execute_readers(@commands.first, other) }.to raise_error(ArgumentError)
+    end
+
+    it 'should raise the error of a failing command and leave the connections usable' do
+      invalid = @connections.last.create_command('SELECT * FROM non_existent_table')
+      expect { described_class.execute_readers(@commands.first, invalid) }.to raise_error(DataObjects::SQLError)
+      @connections.first.create_command('SELECT 1').execute_reader.close
+    end
+
+    it 'should raise a QueryTimeoutError for a command past its timeout' do
+      @commands.first.timeout = 0.2
+      expect { described_class.execute_readers(*@commands) }.to raise_error(DataObjects::QueryTimeoutError)
+      @connections.first.create_command('SELECT 1').execute_reader.close
+    end
+
+    if defined?(Fiber.set_scheduler)
+
+      it 'should only block the current fiber under a Fiber scheduler' do
+        fast    = @connections.first.create_command('SELECT 1')
+        yielded = []
+        ticks   = 0
+
+        Thread.new do
+          Fiber.set_scheduler(DataObjects::Spec::FiberScheduler.new)
+          Fiber.schedule do
+            described_class.execute_readers(fast, *@commands[1..-1]) do |command, reader|
+              yielded << [command, ticks]
+              reader.close
+            end
+          end
+          Fiber.schedule { 5.times { sleep 0.05; ticks += 1 } }
+        end.join
+
+        yielded.size.should == 4
+        yielded.first.first.should == fast
+        yielded.last.last.should == 5
+      end
+
+    end
+
+  end
+end
+
+shared_examples_for 'a Command with a non-blocking API' do
+
+  before :all do
+    setup_test_environment
+  end
+
+  before do
+    @connection = DataObjects::Connection.new(CONFIG.uri)
+  end
+
+  after do
+    @connection.close
+  end
+
+  describe 'send_reader' do
+
+    it 'should return before the query finished' do
+      start = Time.now
+      @connection.create_command(CONFIG.sleep).send_reader
+      (Time.now - start).should < 0.5
+      @connection.get_result.close
+    end
+
+    it 'should let an event loop wait for the result' do
+      @connection.create_command('SELECT ?').send_reader(1)
+      nil until @connection.flush
+      while @connection.busy?
+        IO.select([ @connection.socket_io ])
+        @connection.consume_input
+      end
+      reader = @connection.get_result
+      reader.next!
+      reader.values.should == [1]
+      reader.close
+    end
+
+    it 'should refuse a second query before the result was fetched' do
+      command = @connection.create_command('SELECT 1')
+      command.send_reader
+      expect { command.send_reader }.to raise_error(DataObjects::ConnectionError)
+      @connection.get_result.close
+    end
+
+    it 'should raise the error of the query from get_result and leave the connection usable' do
+      @connection.create_command('SELECT * FROM non_existent_table').send_reader
+      expect { @connection.get_result }.to raise_error(DataObjects::SQLError)
+      @connection.create_command('SELECT 1').execute_reader.close
+    end
+
+    it 'should cancel a query that was never picked up when the connection is released' do
+      @connection.create_command(CONFIG.sleep).send_reader
+      start = Time.now
+      @connection.release
+      (Time.now - start).should < 1
+      @connection.get_result.should be_nil
+    end
+
+  end
+
+  describe 'send_non_query' do
+
+    it 'should return a Result from get_result' do
+      @connection.create_command("INSERT INTO users (name) VALUES (?)").send_non_query("monkey")
+      result = @connection.get_result
+      result.should be_kind_of(DataObjects::Result)
+      result.affected_rows.should == 1
+    end
+
+  end
+
+  describe 'get_result' do
+
+    it 'should return nil when nothing was sent' do
+      @connection.get_result.should be_nil
+    end
+
+  end
+
+end
+
+shared_examples_for 'a Command with query timeouts' do
+
+  before :all do
+    setup_test_environment
+  end
+
+  before do
+    @connection = DataObjects::Connection.new(CONFIG.uri)
+  end
+
+  after do
+    @connection.close
+  end
+
+  it 'should raise a QueryTimeoutError once the timeout passed' do
+    command = @connection.create_command(CONFIG.sleep)
+    command.timeout = 0.2
+    start = Time.now
+    expect { command.execute_reader.next! }.to raise_error(DataObjects::QueryTimeoutError)
+    (Time.now - start).should < 0.9
+  end
+
+  it 'should take the query_timeout of the connection' do
+    @connection.query_timeout = 0.2
+    begin
+      expect { @connection.create_command(CONFIG.sleep).execute_non_query }.to raise_error(DataObjects::QueryTimeoutError)
+    ensure
+      @connection.query_timeout = nil
+    end
+  end
+
+  it 'should leave the connection usable' do
+    command = @connection.create_command(CONFIG.sleep)
+    command.timeout = 0.2
+    expect { command.execute_non_query }.to raise_error(DataObjects::QueryTimeoutError)
+
+    reader = @connection.create_command('SELECT 1').execute_reader
+    reader.next!
+    reader.values.should == [1]
+    reader.close
+  end
+
+  it 'should not take connections from the pool to cancel queries' do
+    pool = DataObjects::Connection.spec(CONFIG.uri).pool
+    size = pool.size
+
+    3.times do
+      command = @connection.create_command(CONFIG.sleep)
+      command.timeout = 0.2
+      expect { command.execute_non_query }.to raise_error(DataObjects::QueryTimeoutError)
+    end
+
+    pool.size.should == size
+  end
+
+  it 'should not get in the way of a query that finishes in time' do
+    command = @connection.create_command('SELECT 1')
+    command.timeout = 5
+    reader = command.execute_reader
+    reader.next!
+    reader.values.should == [1]
+    reader.close
+  end
+
+end
@@ -1,3 +1,6 @@
+require 'socket'
+require 'timeout'
+
 shared_examples_for 'a Connection' do
 
   before :all do
@@ -147,6 +150,42 @@ ensure
   conn.close
 end
 
+shared_examples_for 'a Connection with connect timeouts' do
+
+  before do
+    # A server that accepts connections, but never answers
+    @server   = TCPServer.new('127.0.0.1', 0)
+    @clients  = []
+    @acceptor = Thread.new { loop { @clients << @server.accept } }
+    @uri      = "#{CONFIG.scheme}://#{CONFIG.user_info}127.0.0.1:#{@server.addr[1]}#{CONFIG.database}"
+  end
+
+  after do
+    @acceptor.kill
+    @clients.each { |client| client.close }
+    @server.close
+  end
+
+  it 'should give up after connect_timeout seconds' do
+    start = Time.now
+    expect { DataObjects::Connection.new("#{@uri}?connect_timeout=1") }.to raise_error(DataObjects::ConnectionError)
+    (Time.now - start).should < 3
+  end
+
+  it 'should let other threads run while connecting' do
+    ticks  = 0
+    ticker = Thread.new { loop { ticks += 1; sleep 0.05 } }
+    expect { DataObjects::Connection.new("#{@uri}?connect_timeout=1") }.to raise_error(DataObjects::ConnectionError)
+    ticker.kill
+    ticks.should > 5
+  end
+
+  it 'should abandon connecting when interrupted' do
+    expect { Timeout.timeout(0.5) { DataObjects::Connection.new("#{@uri}?connect_timeout=5") } }.to raise_error(Timeout::Error)
+  end
+
+end
+
 shared_examples_for 'a Connection with JDBC URL support' do
 
   it 'should work with JDBC URLs' do
@@ -76,8 +76,18 @@ module DataObjects
       @relative
     end
 
+    # Freezing a URI freezes its query too, and keeps its string form, which
+    # is also used for hashing.
+    def freeze
+      @query.freeze if @query
+      @string = to_s
+      super
+    end
+
     # Display this URI object as a string
     def to_s
+      return @string if frozen?
+
       string = ""
       string << "#{scheme}:"     if scheme
       string << "#{subscheme}:"  if subscheme
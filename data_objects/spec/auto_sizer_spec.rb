@@ -0,0 +1,116 @@
+require File.expand_path(File.join(File.dirname(__FILE__), 'spec_helper'))
+
+describe DataObjects::Pooling::AutoSizer do
+
+  before do
+    Object.send(:remove_const, :Sized) if defined?(Sized)
+    class ::Sized
+      include DataObjects::Pooling
+
+      attr_reader :name
+
+      def initialize(name)
+        @name = name
+      end
+
+      def dispose
+        @name = nil
+      end
+
+      def self.pool_size
+        2
+      end
+    end
+
+    @pool = Sized.__pool('Bob')
+  end
+
+  after do
+    @pool.dispose
+  end
+
+  def wait_once
+    held = (1..@pool.max_size).map { Sized.new('Bob') }
+    waiter = Thread.new { Sized.new('Bob') }
+    sleep(0.05)
+    held.first.release
+    held.first.should equal(waiter.value)
+    held.each { |instance| instance.release }
+  end
+
+  it "should grow the pool when checkouts had to wait" do
+    sizer = DataObjects::Pooling::AutoSizer.new(:max_size => 4)
+    wait_once
+    sizer.adjust(@pool)
+    @pool.max_size.should == 3
+    sizer.decisions.last[:from].should == 2
+    sizer.decisions.last[:to].should == 3
+  end
+
+  it "should not grow the pool when the latency went up" do
+    limiter = DataObjects::ConcurrencyLimiter.new
+    @pool.concurrency_limiter = limiter
+    sizer = DataObjects::Pooling::AutoSizer.new(:min_size => 2)
+
+    limiter.instance_variable_set(:@latency, 0.01)
+    sizer.adjust(@pool)
+    limiter.instance_variable_set(:@latency, 0.1)
+    wait_once
+    sizer.adjust(@pool)
+
+    @pool.max_size.should == 2
+    sizer.decisions.should be_empty
+  end
+
+  it "should shrink an underused pool and discard idle instances beyond its size" do
+    sizer = DataObjects::Pooling::AutoSizer.new(:samples => 3)
+    @pool.prewarm(2)
+    3.times { sizer.adjust(@pool) }
+    @pool.max_size.should == 1
+    @pool.size.should == 1
+  end
+
+  it "should average the utilization over its samples before shrinking" do
+    sizer = DataObjects::Pooling::AutoSizer.new(:samples => 2)
+    held = (1..@pool.max_size).map { Sized.new('Bob') }
+    sizer.adjust(@pool)
+    held.each { |instance| instance.release }
+    sizer.adjust(@pool)
+    @pool.max_size.should == 2
+
+    sizer.adjust(@pool)
+    @pool.max_size.should == 1
+  end
+
+  it "should not grow the pool for waits shorter than the min wait time" do
+    sizer = DataObjects::Pooling::AutoSizer.new(:max_size => 4, :min_wait_time => 10)
+    wait_once
+    sizer.adjust(@pool)
+    @pool.max_size.should == 2
+  end
+
+  it "should start counting over for a new pool" do
+    sizer = DataObjects::Pooling::AutoSizer.new(:max_size => 4)
+    wait_once
+    wait_once
+    sizer.adjust(@pool)
+    @pool.max_size.should == 3
+
+    @pool.dispose
+    @pool = Sized.__pool('Bob')
+    wait_once
+    sizer.adjust(@pool)
+    @pool.max_size.should == 3
+  end
+
+  it "should hand new room to waiting threads when the pool grows" do
+    held = (1..@pool.max_size).map { Sized.new('Bob') }
+    waiter = Thread.new { Sized.new('Bob') }
+    sleep(0.05)
+    @pool.resize(3)
+    waiter.value.name.should == 'Bob'
+    @pool.size.should == 3
+    held.each { |instance| instance.release }
+  end
+
+end
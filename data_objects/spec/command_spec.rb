@@ -22,4 +22,19 @@ describe DataObjects::Command do
     end
   end
 
+  describe 'timeout' do
+    it 'should be nil by default' do
+      @command.timeout.should be_nil
+    end
+
+    it 'should default to the query_timeout of the connection' do
+      connection = DataObjects::Connection.new('mock://localhost/timeout?query_timeout=5')
+      command = DataObjects::Command.new(connection, 'SQL STRING')
+      command.timeout.should == 5
+      command.timeout = 1
+      command.timeout.should == 1
+      connection.close
+    end
+  end
+
 end
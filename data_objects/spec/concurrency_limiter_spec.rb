@@ -0,0 +1,53 @@
+require File.expand_path(File.join(File.dirname(__FILE__), 'spec_helper'))
+
+describe DataObjects::ConcurrencyLimiter do
+
+  it "should reject queries beyond the limit" do
+    limiter = DataObjects::ConcurrencyLimiter.new(:initial_limit => 1)
+    running = Thread.new { limiter.run { sleep(0.2) } }
+    sleep(0.05)
+
+    lambda { limiter.run { } }.should raise_error(DataObjects::ConcurrencyLimiter::LimitExceededError)
+    limiter.rejections.should == 1
+    running.join
+  end
+
+  it "should queue queries for the queue timeout" do
+    limiter = DataObjects::ConcurrencyLimiter.new(:initial_limit => 1, :queue_timeout => 1)
+    running = Thread.new { limiter.run { sleep(0.1) } }
+    sleep(0.05)
+
+    limiter.run { :done }.should == :done
+    limiter.rejections.should == 0
+    running.join
+  end
+
+  it "should grow the limit while queries are fast" do
+    limiter = DataObjects::ConcurrencyLimiter.new(:initial_limit => 2, :latency_target => 1)
+    10.times { limiter.run { } }
+    limiter.limit.should > 2
+  end
+
+  it "should shrink the limit when queries are slow" do
+    limiter = DataObjects::ConcurrencyLimiter.new(:initial_limit => 10, :latency_target => 0, :backoff => 0.5)
+    2.times { limiter.run { sleep(0.01) } }
+    limiter.limit.should == 2
+    limiter.stats[:latency].should > 0
+  end
+
+  it "should not shrink below the min limit" do
+    limiter = DataObjects::ConcurrencyLimiter.new(:initial_limit => 2, :min_limit => 2, :latency_target => 0)
+    3.times { limiter.run { sleep(0.01) } }
+    limiter.limit.should == 2
+  end
+
+  it "should wrap command execution of connections to a limited URI" do
+    limiter = DataObjects::Connection.concurrency_limit('mock://localhost/limited', :latency_target => 0, :backoff => 0.5)
+    connection = DataObjects::Connection.new('mock://localhost/limited')
+    connection.create_command('INSERT INTO things VALUES (1)').execute_non_query
+    connection.close
+    limiter.limit.should == 5
+    limiter.in_flight.should == 0
+  end
+
+end
@@ -13,6 +13,7 @@ describe DataObjects::Connection do
 
     it { should respond_to(:dispose)        }
     it { should respond_to(:create_command) }
+    it { should be_valid }
 
     its(:to_s)  { should == 'mock://localhost' }
   end
@@ -58,4 +59,134 @@ describe DataObjects::Connection do
 
   end
 
+  describe 'spec' do
+    let(:uri) { 'mock://localhost/spec' }
+
+    it 'should be cached by URI string' do
+      described_class.spec(uri).should equal(described_class.spec(uri))
+    end
+
+    it 'should be frozen, with a frozen URI' do
+      spec = described_class.spec(uri)
+      spec.should be_frozen
+      spec.uri.should be_frozen
+      spec.uri.to_s.should == uri
+    end
+
+    it 'should resolve the driver' do
+      described_class.spec(uri).driver_class.should == DataObjects::Mock::Connection
+      described_class.spec(uri).should be_pooled
+    end
+  end
+
+  describe 'with a priority' do
+    let(:connection) { described_class.new('mock://localhost/batch', :priority => :batch) }
+
+    it { should be_kind_of(DataObjects::Mock::Connection) }
+  end
+
+  describe 'query_timeout' do
+    context 'without the option in the uri' do
+      let(:uri) { 'mock://localhost' }
+
+      its(:query_timeout) { should be_nil }
+    end
+
+    context 'with the option in the uri' do
+      let(:uri) { 'mock://localhost/timeout?query_timeout=2.5' }
+
+      its(:query_timeout) { should == 2.5 }
+    end
+
+    context 'set on a pooled connection' do
+      let(:uri) { 'mock://localhost/timeout?query_timeout=2.5' }
+
+      it 'should be forgotten when the connection goes back to the pool' do
+        connection.query_timeout = 10
+        connection.close
+        described_class.new(uri).should equal(connection)
+        connection.query_timeout.should == 2.5
+      end
+    end
+  end
+
+  describe 'prewarm' do
+    let(:uri) { 'mock://localhost/prewarm' }
+
+    it 'should open the given number of pooled connections' do
+      described_class.prewarm(uri, 3).should == 3
+      connection.should be_kind_of(DataObjects::Mock::Connection)
+    end
+  end
+
+  describe 'pool settings' do
+    let(:uri)  { 'mock://localhost/configured' }
+    let(:spec) { described_class.spec(uri) }
+
+    it 'should be kept when the pool is disposed and created again' do
+      limit   = described_class.global_limit(uri, 2, :directory => Dir.tmpdir)
+      limiter = described_class.concurrency_limit(uri)
+      sizer   = described_class.auto_size(uri)
+      described_class.prewarm(uri, 1, :after_fork => true)
+
+      pool = spec.pool
+      pool.dispose
+      spec.pool.should_not equal(pool)
+
+      spec.pool.global_limit.should equal(limit)
+      spec.pool.concurrency_limiter.should equal(limiter)
+      spec.pool.auto_sizer.should equal(sizer)
+      spec.pool.prewarm_after_fork.should == 1
+    end
+  end
+
+  describe 'within with_connection' do
+    let(:uri)  { 'mock://localhost/sticky' }
+    let(:pool) { described_class.spec(uri).pool }
+
+    it 'should return the same connection every time' do
+      DataObjects.with_connection(uri) do
+        first = described_class.new(uri)
+        first.close
+        described_class.new(uri).should equal(first)
+        pool.used.size.should == 1
+      end
+      pool.used.size.should == 0
+    end
+
+    it 'should only release the connection when the outermost block is left' do
+      DataObjects.with_connection(uri) do
+        first = described_class.new(uri)
+        DataObjects.with_connection(uri) { described_class.new(uri).should equal(first) }
+        pool.used.size.should == 1
+      end
+      pool.used.size.should == 0
+    end
+
+    it 'should not check out a connection until one is asked for' do
+      DataObjects.with_connection(uri) { pool.used.size.should == 0 }
+    end
+
+    it 'should leave the scopes entered before an invalid URI' do
+      DataObjects.with_connection(uri) do
+        first = described_class.new(uri)
+        lambda {
+          DataObjects.with_connection(uri, 'unknown://localhost') { }
+        }.should raise_error
+        described_class.new(uri).should equal(first)
+        pool.used.size.should == 1
+      end
+      pool.used.size.should == 0
+    end
+
+    it 'should leave other URIs alone' do
+      DataObjects.with_connection(uri) do
+        other = described_class.new('mock://localhost/other')
+        other.close
+        described_class.new('mock://localhost/other').should be_kind_of(DataObjects::Mock::Connection)
+        pool.used.size.should == 0
+      end
+    end
+  end
+
 end
@@ -25,6 +25,9 @@ module DataObjects
     end
 
     class Reader < DataObjects::Reader
+      def close
+        true
+      end
     end
   end
 
@@ -0,0 +1,94 @@
+require File.expand_path(File.join(File.dirname(__FILE__), 'spec_helper'))
+require 'tmpdir'
+require 'fileutils'
+
+describe DataObjects::Pooling::GlobalLimit do
+
+  before do
+    @directory = Dir.mktmpdir
+    @limit     = DataObjects::Pooling::GlobalLimit.new('mock://localhost/limited', 2, @directory)
+  end
+
+  after do
+    FileUtils.rm_rf(@directory)
+  end
+
+  it "should hand out at most max slots" do
+    @limit.acquire(0.05).should_not be_nil
+    @limit.acquire(0.05).should_not be_nil
+    @limit.acquire(0.05).should be_nil
+    @limit.held.should == 2
+  end
+
+  it "should hand out a released slot again" do
+    first = @limit.acquire(0.05)
+    @limit.acquire(0.05)
+    @limit.release(first)
+    @limit.acquire(0.05).should == first
+  end
+
+  if Process.respond_to?(:fork) && RUBY_PLATFORM !~ /java|mswin|mingw/
+    it "should count the slots of other processes and recover them when those die" do
+      reader, writer = IO.pipe
+      pid = fork do
+        reader.close
+        limit = DataObjects::Pooling::GlobalLimit.new('mock://localhost/limited', 2, @directory)
+        limit.acquire
+        limit.acquire
+        writer.write('held')
+        writer.close
+        sleep(0.3)
+        exit!(0)
+      end
+      writer.close
+      reader.read.should == 'held'
+
+      @limit.acquire(0.05).should be_nil
+      Process.wait(pid)
+      @limit.acquire(0.05).should_not be_nil
+    end
+  end
+
+  describe "in a pool" do
+
+    before do
+      Object.send(:remove_const, :Limited) if defined?(Limited)
+      class ::Limited
+        include DataObjects::Pooling
+
+        def initialize(name)
+        end
+
+        def dispose
+        end
+
+        def self.pool_checkout_timeout
+          0.1
+        end
+      end
+
+      Limited.__pool('Bob').global_limit = @limit
+    end
+
+    after do
+      Limited.__pool('Bob').dispose
+    end
+
+    it "should raise an error when the global limit is reached" do
+      Limited.new('Bob')
+      Limited.new('Bob')
+      lambda { Limited.new('Bob') }.should raise_error(DataObjects::Pooling::CheckoutTimeoutError)
+      Limited.__pool('Bob').size.should == 2
+    end
+
+    it "should give the slot back when an instance is discarded" do
+      bob = Limited.new('Bob')
+      Limited.new('Bob')
+      bob.detach
+      @limit.held.should == 1
+      Limited.new('Bob').should_not be_nil
+    end
+
+  end
+
+end
@@ -0,0 +1,87 @@
+require File.expand_path(File.join(File.dirname(__FILE__), 'spec_helper'))
+
+describe DataObjects::Pooling::MultiplexedConnection do
+  subject { connection }
+
+  let(:uri)        { 'mock://localhost/multiplexed' }
+  let(:connection) { DataObjects::Connection.new(uri, :multiplex => true) }
+  let(:pool)       { DataObjects::Connection.spec(uri).pool }
+
+  after { connection.close }
+
+  it { should be_kind_of(DataObjects::Pooling::MultiplexedConnection) }
+  it { should_not be_pinned }
+
+  its(:to_s) { should == uri }
+
+  it 'should only check out a connection while a statement runs' do
+    connection.create_command('INSERT INTO widgets VALUES (1)').execute_non_query
+    connection.should_not be_pinned
+    pool.used.size.should == 0
+  end
+
+  it 'should pin the connection while a transaction is open' do
+    connection.create_command('BEGIN').execute_non_query
+    connection.should be_in_transaction
+    connection.should be_pinned
+
+    connection.create_command('ROLLBACK TO SAVEPOINT a').execute_non_query
+    connection.should be_pinned
+
+    connection.create_command('COMMIT').execute_non_query
+    connection.should_not be_in_transaction
+    connection.should_not be_pinned
+  end
+
+  it 'should pin the connection while a reader is open' do
+    reader = connection.create_command('SELECT * FROM widgets').execute_reader
+    connection.should be_pinned
+    reader.close
+    connection.should_not be_pinned
+  end
+
+  it 'should keep the connection for the whole block of pin' do
+    connection.pin do |pinned|
+      pinned.should be_kind_of(DataObjects::Mock::Connection)
+      connection.create_command('SET search_path TO widgets').execute_non_query
+      connection.should be_pinned
+    end
+    connection.should_not be_pinned
+  end
+
+  it 'should dispose of a connection closed within a transaction' do
+    connection.create_command('BEGIN').execute_non_query
+    connection.close
+    connection.should_not be_pinned
+    pool.size.should == 0
+  end
+
+  it 'should set its query_timeout on every connection it checks out' do
+    connection.query_timeout = 3
+    2.times do
+      connection.pin { |pinned| pinned.query_timeout.should == 3 }
+    end
+    connection.query_timeout.should == 3
+    connection.should_not be_pinned
+  end
+
+  it 'should run a command with its own timeout' do
+    command = connection.create_command('UPDATE widgets SET name = ?')
+    command.timeout = 2
+    result = command.execute_non_query('bob')
+    result.instance_variable_get(:@command).timeout.should == 2
+  end
+
+  it 'should not send commands without waiting for them' do
+    command = connection.create_command('SELECT * FROM widgets')
+    lambda { command.send_reader }.should raise_error(NotImplementedError)
+    lambda { command.send_non_query }.should raise_error(NotImplementedError)
+  end
+
+  it 'should delegate other methods to a pooled connection' do
+    connection.should respond_to(:quote_string)
+    connection.quote_string("it's").should == "'it''s'"
+    connection.should_not be_pinned
+  end
+
+end
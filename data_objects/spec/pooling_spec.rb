@@ -144,6 +144,181 @@ describe "DataObjects::Pooling" do
     bob.name.should be_nil
   end
 
+  it "should discard instances that outlived their lifetime on release" do
+    def Overwriter.pool_max_lifetime; 0.1; end
+    bob = Overwriter.new('Bob')
+    sleep(0.15)
+    bob.release
+    bob.name.should be_nil
+    Overwriter.__pools[['Bob']].size.should == 0
+  end
+
+  it "should keep min idle instances when evicting idle ones" do
+    def Overwriter.pool_min_idle; 1; end
+    def Overwriter.pool_max_idle_time; 0; end
+    bob = Overwriter.new('Bob')
+    fred = Overwriter.new('Bob')
+    bob.release
+    fred.release
+
+    pool = Overwriter.__pools[['Bob']]
+    pool.scavenge
+    pool.size.should == 1
+    pool.available.size.should == 1
+  end
+
+  it "should replenish the pool up to min idle instances" do
+    def Overwriter.pool_min_idle; 2; end
+    bob = Overwriter.new('Bob')
+    bob.release
+
+    pool = Overwriter.__pools[['Bob']]
+    pool.flush!
+    pool.size.should == 0
+    pool.scavenge
+    pool.available.size.should == 2
+    pool.available.each { |instance| instance.name.should == 'Bob' }
+  end
+
+  it "should discard idle instances that fail validation" do
+    def Overwriter.pool_validation_interval; 0; end
+    class ::Overwriter
+      def valid?
+        @name != 'Broken'
+      end
+    end
+    bob = Overwriter.new('Bob')
+    fred = Overwriter.new('Bob')
+    fred.name = 'Broken'
+    bob.release
+    fred.release
+
+    pool = Overwriter.__pools[['Bob']]
+    pool.scavenge
+    pool.size.should == 1
+    pool.available.should == [ bob ]
+    bob.name.should == 'Bob'
+  end
+
+  it "should not validate instances that were used recently" do
+    def Overwriter.pool_validation_interval; 60; end
+    class ::Overwriter
+      def valid?
+        false
+      end
+    end
+    Overwriter.new('Bob').release
+
+    pool = Overwriter.__pools[['Bob']]
+    pool.scavenge
+    pool.available.size.should == 1
+  end
+
+  it "should prewarm a pool in parallel" do
+    created = []
+    pool = Overwriter.__pool('Bob')
+    pool.on_create(:track) { |instance| created << instance }
+    pool.prewarm(2).should == 2
+    pool.available.size.should == 2
+    created.size.should == 2
+  end
+
+  it "should not prewarm a pool beyond its size" do
+    Overwriter.__pool('Bob').prewarm(Overwriter.pool_size + 1).should == Overwriter.pool_size
+  end
+
+  it "should discard an instance when a create callback fails" do
+    pool = Overwriter.__pool('Bob')
+    pool.on_create(:fail) { |instance| raise ArgumentError }
+    lambda { Overwriter.new('Bob') }.should raise_error(ArgumentError)
+    pool.size.should == 0
+  end
+
+  it "should cap batch checkouts to their share of the pool" do
+    def Overwriter.pool_checkout_timeout; 0.1; end
+    pool = Overwriter.__pool('Bob')
+    batch = (1..pool.batch_limit).map { pool.new(:batch) }
+
+    lambda { pool.new(:batch) }.should raise_error(DataObjects::Pooling::CheckoutTimeoutError)
+    bob = Overwriter.new('Bob')
+    bob.should_not be_nil
+
+    pool.stats[:batch][:timeouts].should == 1
+    pool.stats[:interactive][:waits].should == 0
+    bob.release
+    batch.each { |instance| instance.release }
+  end
+
+  it "should serve interactive waiters before batch waiters" do
+    pool = Overwriter.__pool('Bob')
+    held = (1..Overwriter.pool_size).map { Overwriter.new('Bob') }
+    order = []
+
+    batch = Thread.new { bob = pool.new(:batch); order << :batch; bob }
+    sleep(0.05)
+    interactive = Thread.new { bob = pool.new; order << :interactive; bob }
+    sleep(0.05)
+
+    held.each { |instance| instance.release }
+    [batch, interactive].each { |thread| thread.value.release }
+    order.should == [:interactive, :batch]
+    pool.stats[:batch][:waits].should == 1
+    pool.stats[:interactive][:waits].should == 1
+  end
+
+  it "should reject unknown priorities" do
+    lambda { Overwriter.__pool('Bob').new(:urgent) }.should raise_error(ArgumentError)
+  end
+
+  if Process.respond_to?(:fork) && RUBY_PLATFORM !~ /java|mswin|mingw/
+    def in_fork
+      reader, writer = IO.pipe
+      pid = fork do
+        reader.close
+        writer.write(yield.inspect)
+        writer.close
+        exit!(0)
+      end
+      writer.close
+      result = reader.read
+      Process.wait(pid)
+      result
+    end
+
+    it "should start over with new instances in a forked child" do
+      bob = Overwriter.new('Bob')
+      bob.release
+
+      result = in_fork do
+        fred = Overwriter.new('Bob')
+        [fred.equal?(bob), bob.name, Overwriter.__pools[['Bob']].size, DataObjects::Pooling.scavenger?]
+      end
+      result.should == [false, 'Bob', 1, true].inspect
+    end
+
+    it "should not take back instances checked out before the fork" do
+      bob = Overwriter.new('Bob')
+
+      result = in_fork do
+        bob.release
+        [bob.instance_variable_get(:@__pool).nil?, Overwriter.__pools[['Bob']].size]
+      end
+      result.should == [true, 0].inspect
+      bob.release
+    end
+
+    it "should prewarm a pool in a forked child" do
+      pool = Overwriter.__pool('Bob')
+      pool.prewarm_after_fork = 2
+
+      result = in_fork do
+        Overwriter.new('Bob')
+        [pool.size, pool.available.size]
+      end
+      result.should == [2, 1].inspect
+    end
+  end
+
   it "should wake up the scavenger thread when exiting" do
     bob = Person.new('Bob')
     bob.release
@@ -152,6 +327,21 @@ describe "DataObjects::Pooling" do
     DataObjects::Pooling.scavenger?.should be_false
   end
 
+  it "should discard a pending result on release" do
+    class ::Person
+      attr_reader :discarded
+
+      private
+
+      def discard_pending
+        @discarded = true
+      end
+    end
+    bob = Person.new('Bob')
+    bob.release
+    bob.discarded.should be_true
+  end
+
   it "should be able to detach an instance from the pool" do
     bob = Person.new('Bob')
     Person.__pools[['Bob']].size.should == 1
@@ -159,4 +349,110 @@ describe "DataObjects::Pooling" do
     Person.__pools[['Bob']].size.should == 0
   end
 
+  it "should hand the last released instance back to the same thread" do
+    bob = Overwriter.new('Bob')
+    fred = Overwriter.new('Bob')
+    fred.release
+    bob.release
+    Overwriter.new('Bob').should equal(bob)
+  end
+
+  it "should list the used instances by object_id and the available ones" do
+    bob = Overwriter.new('Bob')
+    fred = Overwriter.new('Bob')
+    fred.release
+
+    pool = Overwriter.__pools[['Bob']]
+    pool.used.should == { bob.object_id => bob }
+    pool.available.should == [ fred ]
+    bob.release
+  end
+
+  it "should let go of the thread caches when disposed" do
+    bob = Overwriter.new('Bob')
+    bob.release
+
+    pool = Overwriter.__pools[['Bob']]
+    pool.dispose
+    pool.instance_variable_get(:@thread_cache)[Thread.current].should be_nil
+    Thread.current[:__data_objects_pool_cache].should be_nil
+    Overwriter.new('Bob').should_not equal(bob)
+  end
+
+  it "should hand a released instance to a waiting thread" do
+    held = (1..Overwriter.pool_size).map { Overwriter.new('Bob') }
+    waiter = Thread.new { Overwriter.new('Bob') }
+    sleep(0.1)
+    waiter.should be_alive
+    held.first.release
+    waiter.value.should equal(held.first)
+    held.each { |instance| instance.release }
+  end
+
+  it "should serve waiting threads in the order they arrived" do
+    held = (1..Overwriter.pool_size).map { Overwriter.new('Bob') }
+    order = []
+    waiters = (1..3).map do |i|
+      thread = Thread.new do
+        bob = Overwriter.new('Bob')
+        order << i
+        bob.release
+      end
+      sleep(0.05)
+      thread
+    end
+    held.first.release
+    waiters.each { |thread| thread.join }
+    order.should == [1, 2, 3]
+    held.each { |instance| instance.release }
+  end
+
+  it "should raise an error when no instance is released within the checkout timeout" do
+    def Overwriter.pool_checkout_timeout; 0.1; end
+    held = (1..Overwriter.pool_size).map { Overwriter.new('Bob') }
+
+    lambda { Overwriter.new('Bob') }.should raise_error(DataObjects::Pooling::CheckoutTimeoutError)
+
+    stats = Overwriter.__pools[['Bob']].stats
+    stats[:waits].should == 1
+    stats[:timeouts].should == 1
+    stats[:max_wait_time].should >= 0.1
+    held.each { |instance| instance.release }
+  end
+
+  it "should count the time threads waited for an instance" do
+    held = (1..Overwriter.pool_size).map { Overwriter.new('Bob') }
+    waiter = Thread.new { Overwriter.new('Bob').release }
+    sleep(0.2)
+    held.each { |instance| instance.release }
+    waiter.join
+
+    stats = Overwriter.__pools[['Bob']].stats
+    stats[:waits].should == 1
+    stats[:timeouts].should == 0
+    stats[:wait_time].should >= 0.1
+  end
+
+  it "should never hand out an instance to two threads at once" do
+    in_use = {}
+    conflicts = 0
+    check = Mutex.new
+
+    threads = (1..8).map do
+      Thread.new do
+        200.times do
+          bob = Overwriter.new('Bob')
+          check.synchronize { conflicts += 1 if in_use[bob.object_id]; in_use[bob.object_id] = true }
+          Thread.pass
+          check.synchronize { in_use.delete(bob.object_id) }
+          bob.release
+        end
+      end
+    end
+    threads.each { |thread| thread.join }
+
+    conflicts.should == 0
+    Overwriter.__pools[['Bob']].size.should <= Overwriter.pool_size
+  end
+
 end
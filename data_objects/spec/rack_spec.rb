@@ -0,0 +1,42 @@
+require File.expand_path(File.join(File.dirname(__FILE__), 'spec_helper'))
+require 'data_objects/rack'
+
+describe DataObjects::Rack do
+
+  let(:uri)  { 'mock://localhost/rack' }
+  let(:pool) { DataObjects::Connection.spec(uri).pool }
+
+  let(:app) do
+    lambda do |env|
+      connection = DataObjects::Connection.new(uri)
+      connection.close
+      env[:connection] = connection
+      env[:same] = DataObjects::Connection.new(uri).equal?(connection)
+      [200, {}, ['OK']]
+    end
+  end
+
+  subject { described_class.new(app, uri) }
+
+  it 'should hand out the same connection for the whole request' do
+    env = {}
+    status, headers, body = subject.call(env)
+    env[:same].should be_true
+    pool.used.size.should == 1
+    body.close
+    pool.used.size.should == 0
+  end
+
+  it 'should pass the body on' do
+    status, headers, body = subject.call({})
+    body.to_enum(:each).to_a.should == ['OK']
+    body.close
+  end
+
+  it 'should release the connection when the app raises' do
+    failing = described_class.new(lambda { |env| DataObjects::Connection.new(uri); raise 'boom' }, uri)
+    lambda { failing.call({}) }.should raise_error(RuntimeError)
+    pool.used.size.should == 0
+  end
+
+end
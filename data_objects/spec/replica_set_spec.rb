@@ -0,0 +1,135 @@
+require File.expand_path(File.join(File.dirname(__FILE__), 'spec_helper'))
+
+describe DataObjects::ReplicaSet do
+
+  let(:primary)  { 'mock://primary/app' }
+  let(:replicas) { %w(mock://replica1/app mock://replica2/app) }
+  let(:options)  { { :check_interval => nil } }
+  let(:set)      { described_class.new(primary, replicas, options) }
+
+  def pool(uri)
+    DataObjects::Connection.spec(uri).pool
+  end
+
+  it 'should pick replicas round robin' do
+    picked = (1..4).map { set.replica.spec.uri.to_s }
+    picked.uniq.sort.should == replicas
+    picked[0].should_not == picked[1]
+  end
+
+  it 'should pick the replica with the least latency' do
+    set = described_class.new(primary, replicas, options.merge(:strategy => :least_latency))
+    set.replicas[0].record(0.5)
+    set.replicas[1].record(0.1)
+    set.replica.should equal(set.replicas[1])
+  end
+
+  it 'should refuse an unknown strategy' do
+    lambda { described_class.new(primary, replicas, :strategy => :random) }.should raise_error(ArgumentError)
+  end
+
+  it 'should skip unhealthy replicas until they are healthy again' do
+    set.replicas[0].mark(false)
+    (1..3).map { set.replica }.uniq.should == [ set.replicas[1] ]
+
+    set.check_health
+    set.replicas[0].should be_healthy
+  end
+
+  it 'should have no replica when none is healthy' do
+    set.replicas.each { |replica| replica.mark(false) }
+    set.replica.should be_nil
+  end
+
+  it 'should measure the lag of PostgreSQL replicas before 10 with the xlog functions' do
+    replica = set.replicas[0]
+    replica.server_version = 90600
+    set.send(:postgres_lag_query, replica, nil).should == described_class::POSTGRES_9_LAG_QUERY
+
+    replica.server_version = 100000
+    set.send(:postgres_lag_query, replica, nil).should == described_class::LAG_QUERIES['postgres']
+  end
+
+  describe 'connection' do
+    subject { set.connection }
+
+    after { subject.close }
+
+    it 'should send reads to a replica' do
+      reader = subject.create_command('SELECT * FROM widgets').execute_reader
+      (pool(replicas[0]).used.size + pool(replicas[1]).used.size).should == 1
+      pool(primary).used.size.should == 0
+      reader.close
+    end
+
+    it 'should send writes to the primary' do
+      subject.create_command('UPDATE widgets SET name = ?').execute_non_query('bob')
+      pool(primary).size.should > 0
+      subject.should be_reading_own_writes
+    end
+
+    it 'should read from the primary for a while after a write' do
+      subject.create_command('DELETE FROM widgets').execute_non_query
+      reader = subject.create_command('SELECT * FROM widgets').execute_reader
+      pool(primary).used.size.should == 1
+      reader.close
+    end
+
+    it 'should read from a replica again once the write window is over' do
+      set = described_class.new(primary, replicas, options.merge(:write_window => 0))
+      connection = set.connection
+      connection.create_command('DELETE FROM widgets').execute_non_query
+      connection.should_not be_reading_own_writes
+      reader = connection.create_command('SELECT * FROM widgets').execute_reader
+      pool(primary).used.size.should == 0
+      reader.close
+      connection.close
+    end
+
+    it 'should keep transactions on the primary' do
+      set = described_class.new(primary, replicas, options.merge(:write_window => 0))
+      connection = set.connection
+      connection.create_command('BEGIN').execute_non_query
+      connection.should be_in_transaction
+      connection.create_command('SELECT * FROM widgets').execute_reader.close
+      (pool(replicas[0]).used.size + pool(replicas[1]).used.size).should == 0
+      connection.create_command('COMMIT').execute_non_query
+      connection.close
+    end
+
+    it 'should send locking reads to the primary' do
+      reader = subject.create_command('SELECT * FROM widgets FOR UPDATE').execute_reader
+      pool(primary).used.size.should == 1
+      reader.close
+    end
+
+    it 'should read from the primary when no replica is healthy' do
+      set.replicas.each { |replica| replica.mark(false) }
+      reader = subject.create_command('SELECT * FROM widgets').execute_reader
+      pool(primary).used.size.should == 1
+      reader.close
+    end
+
+    it 'should read its own writes made through another connection of the thread' do
+      other = set.connection
+      other.create_command('DELETE FROM widgets').execute_non_query
+      other.close
+      reader = subject.create_command('SELECT * FROM widgets').execute_reader
+      pool(primary).used.size.should == 1
+      reader.close
+    end
+
+    it 'should run a command with its own timeout' do
+      command = subject.create_command('UPDATE widgets SET name = ?')
+      command.timeout = 2
+      command.execute_non_query('bob').instance_variable_get(:@command).timeout.should == 2
+    end
+
+    it 'should not read the writes of other threads from the primary' do
+      set = described_class.new('mock://primary/threads', replicas, options)
+      Thread.new { set.connection.create_command('DELETE FROM widgets').execute_non_query }.join
+      set.should_not be_reading_own_writes
+    end
+  end
+
+end
@@ -0,0 +1,159 @@
+require File.expand_path(File.join(File.dirname(__FILE__), 'spec_helper'))
+
+module DataObjects
+  # Shards with a table of [id, name] rows, sorted by id
+  module Shardmock
+    ROWS = {
+      'one'  => [ [1, 'a'], [4, 'd'], [5, nil] ],
+      'two'  => [ [2, 'b'], [3, 'c'] ],
+      'text' => [ ['x', 'y'] ]
+    }
+
+    class Connection < DataObjects::Connection
+      def initialize(uri)
+        @uri = uri
+      end
+
+      def dispose
+        nil
+      end
+    end
+
+    class Command < DataObjects::Command
+      def execute_non_query(*args)
+        Result.new(self, 1, nil)
+      end
+
+      def execute_reader(*args)
+        raise DataObjects::SQLError.new('boom') if @text =~ /boom/ && connection.to_s =~ /two/
+        Reader.new(ROWS[URI.parse(connection.to_s).host])
+      end
+    end
+
+    class Result < DataObjects::Result
+    end
+
+    class Reader < DataObjects::Reader
+      def initialize(rows)
+        @rows, @row = rows.dup, nil
+      end
+
+      def fields
+        %w(id name)
+      end
+
+      def field_count
+        2
+      end
+
+      def next!
+        !(@row = @rows.shift).nil?
+      end
+
+      def values
+        @row
+      end
+
+      def close
+        true
+      end
+    end
+  end
+end
+
+describe DataObjects::ShardRouter do
+
+  let(:shards) { %w(shardmock://one/app shardmock://two/app) }
+  let(:router) { described_class.new(shards) }
+
+  def pool(uri)
+    DataObjects::Connection.spec(uri).pool
+  end
+
+  describe 'shard_for' do
+    it 'should map a key to the same shard every time' do
+      router.shard_for(42).should == router.shard_for(42)
+      shards.should include(router.shard_for('tenant-1'))
+    end
+
+    it 'should map keys by range' do
+      router = described_class.new(10..19 => shards[1], 0..9 => shards[0])
+      router.shard_for(3).should  == shards[0]
+      router.shard_for(15).should == shards[1]
+      lambda { router.shard_for(20) }.should raise_error(ArgumentError)
+    end
+  end
+
+  describe 'execute_reader' do
+    it 'should only run on the shard of the key' do
+      router = described_class.new(0..9 => shards[0], 10..19 => shards[1])
+      reader = router.create_command('SELECT * FROM widgets', :key => 12).execute_reader
+      reader.map { |row| row['id'] }.should == [2, 3]
+    end
+
+    it 'should return the reader of the shard for a key and give its connection back on close' do
+      reader = router.create_command('SELECT * FROM widgets', :key => 12).execute_reader
+      reader.should be_kind_of(DataObjects::Shardmock::Reader)
+      reader.close
+      shards.each { |uri| pool(uri).used.size.should == 0 }
+    end
+
+    it 'should concatenate the rows of all shards without a key' do
+      reader = router.create_command('SELECT * FROM widgets').execute_reader
+      reader.map { |row| row['id'] }.should == [1, 4, 5, 2, 3]
+    end
+
+    it 'should merge the rows of all shards by :order_by' do
+      reader = router.create_command('SELECT * FROM widgets ORDER BY id', :order_by => 'id').execute_reader
+      reader.map { |row| row['id'] }.should == [1, 2, 3, 4, 5]
+    end
+
+    it 'should sort NULLs last' do
+      reader = router.create_command('SELECT * FROM widgets ORDER BY name', :order_by => 'name').execute_reader
+      reader.map { |row| row['name'] }.should == ['a', 'b', 'c', 'd', nil]
+    end
+
+    it 'should raise an ArgumentError for values that do not compare' do
+      router = described_class.new([ shards[0], 'shardmock://text/app' ])
+      reader = router.create_command('SELECT * FROM widgets ORDER BY id', :order_by => 'id').execute_reader
+      lambda { reader.next! }.should raise_error(ArgumentError, /compare/)
+      reader.close
+    end
+
+    it 'should raise an error when reading values before next!' do
+      reader = router.create_command('SELECT * FROM widgets').execute_reader
+      lambda { reader.values }.should raise_error(DataObjects::DataError)
+      reader.close
+    end
+
+    it 'should give the connections back when the reader is closed' do
+      reader = router.create_command('SELECT * FROM widgets').execute_reader
+      shards.each { |uri| pool(uri).used.size.should == 1 }
+      reader.close
+      shards.each { |uri| pool(uri).used.size.should == 0 }
+    end
+
+    it 'should raise the error of a shard and close the others' do
+      lambda { router.create_command('SELECT boom').execute_reader }.should raise_error(DataObjects::SQLError)
+      shards.each { |uri| pool(uri).used.size.should == 0 }
+    end
+  end
+
+  describe 'execute_non_query' do
+    it 'should run on the shard of the key' do
+      router.create_command('DELETE FROM widgets', :key => 1).execute_non_query.affected_rows.should == 1
+    end
+
+    it 'should refuse to write to every shard unless asked to' do
+      lambda { router.create_command('DELETE FROM widgets').execute_non_query }.should raise_error(ArgumentError)
+      router.create_command('DELETE FROM widgets', :all => true).execute_non_query.affected_rows.should == 2
+    end
+
+    it 'should run with the timeout of the command' do
+      command = router.create_command('DELETE FROM widgets', :key => 1)
+      command.timeout = 2
+      command.execute_non_query.instance_variable_get(:@command).timeout.should == 2
+    end
+  end
+
+end
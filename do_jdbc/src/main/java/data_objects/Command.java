@@ -144,6 +144,7 @@ public class Command extends DORubyObject {
             } else {
                 sqlSimpleStatement = conn.createStatement();
             }
+            setQueryTimeout(usePS ? sqlStatement : sqlSimpleStatement);
 
             long startTime = System.currentTimeMillis();
             if (usePS) {
@@ -252,6 +253,7 @@ public class Command extends DORubyObject {
                            ResultSet.CONCUR_READ_ONLY);
 
             prepareStatementFromArgs(sqlText, sqlStatement, args);
+            setQueryTimeout(sqlStatement);
 
             long startTime = System.currentTimeMillis();
             resultSet = sqlStatement.executeQuery();
@@ -384,6 +386,20 @@ public class Command extends DORubyObject {
 
     // ---------------------------------------------------------- HELPER METHODS
 
+    /**
+     * Passes Command#timeout on to the statement. JDBC only takes whole
+     * seconds, so it's rounded up.
+     *
+     * @param statement
+     * @throws SQLException
+     */
+    private void setQueryTimeout(Statement statement) throws SQLException {
+        IRubyObject timeout = api.callMethod(this, "timeout");
+        if (!timeout.isNil()) {
+            statement.setQueryTimeout((int) Math.ceil(RubyNumeric.num2dbl(timeout)));
+        }
+    }
+
     /**
      *
      * @param conn
@@ -2,6 +2,7 @@ package data_objects.errors;
 
 import data_objects.drivers.DriverDefinition;
 import java.sql.SQLException;
+import java.sql.SQLTimeoutException;
 import java.sql.Statement;
 import java.util.regex.Matcher;
 import java.util.regex.Pattern;
@@ -29,7 +30,8 @@ public final class Errors {
         DATA_ERROR        ("DataError"),
         INTEGRITY_ERROR   ("IntegrityError"),
         SYNTAX_ERROR      ("SyntaxError"),
-        TRANSACTION_ERROR ("TransactionError");
+        TRANSACTION_ERROR ("TransactionError"),
+        QUERY_TIMEOUT_ERROR ("QueryTimeoutError");
 
         private final String rubyName;
 
@@ -105,7 +107,8 @@ public final class Errors {
             DriverDefinition driver, SQLException exception,
             java.sql.Statement statement) {
         RubyModule doModule = runtime.getModule(DATA_OBJECTS_MODULE_NAME);
-        RubyClass driverError = doModule.getClass(Type.SQL_ERROR.getRubyName());
+        RubyClass driverError = doModule.getClass(isQueryTimeout(exception, statement) ?
+                Type.QUERY_TIMEOUT_ERROR.getRubyName() : Type.SQL_ERROR.getRubyName());
 
         String message = exception.getLocalizedMessage();
         int code = exception.getErrorCode();
@@ -130,6 +133,30 @@ public final class Errors {
         return new RaiseException(doSqlError);
     }
 
+    /**
+     * Whether the statement was cancelled because of its query timeout. Not
+     * every driver throws a SQLTimeoutException, PostgreSQL reports the
+     * cancel with SQL state 57014, MySQL with 70100.
+     *
+     * @param exception
+     * @param statement
+     * @return
+     */
+    private static boolean isQueryTimeout(SQLException exception, java.sql.Statement statement) {
+        if (exception instanceof SQLTimeoutException) {
+            return true;
+        }
+        try {
+            if (statement == null || statement.getQueryTimeout() == 0) {
+                return false;
+            }
+        } catch (SQLException ignored) {
+            return false;
+        }
+        String sqlState = exception.getSQLState();
+        return "57014".equals(sqlState) || "70100".equals(sqlState);
+    }
+
     public static RaiseException newError(Ruby runtime, RubyClass errorClass, String message) {
         return new RaiseException(runtime, errorClass, message, true);
     }
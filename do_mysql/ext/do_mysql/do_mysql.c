@@ -1,6 +1,7 @@
 #include <ruby.h>
 #include <time.h>
 #include <string.h>
+#include <math.h>
 
 #include <mysql.h>
 #include <errmsg.h>
@@ -25,6 +26,9 @@
 #define CHECK_AND_RAISE(mysql_result_value, query) if (0 != mysql_result_value) { do_mysql_raise_error(self, db, query); }
 
 void do_mysql_full_connect(VALUE self, MYSQL *db);
+VALUE do_mysql_build_reader(VALUE self, VALUE connection, MYSQL *db, MYSQL_RES *response);
+VALUE do_mysql_build_result(VALUE self, MYSQL *db, MYSQL_RES *response);
+void do_mysql_discard_pending(VALUE connection, MYSQL *db);
 
 // Classes that we'll build in Init
 VALUE mMysql;
@@ -137,36 +141,154 @@ MYSQL_RES *do_mysql_cCommand_execute_sync(VALUE self, VALUE connection, MYSQL *d
   return mysql_store_result(db);
 }
 #else
-MYSQL_RES *do_mysql_cCommand_execute_async(VALUE self, VALUE connection, MYSQL *db, VALUE query) {
+void do_mysql_send_query(VALUE self, VALUE connection, MYSQL *db, VALUE query) {
   int retval;
 
+  do_mysql_discard_pending(connection, db);
+
   if ((retval = mysql_ping(db)) && mysql_errno(db) == CR_SERVER_GONE_ERROR) {
     do_mysql_full_connect(connection, db);
   }
 
-  struct timeval start;
   const char *str = rb_str_ptr_readonly(query);
   long len = rb_str_len(query);
 
-  gettimeofday(&start, NULL);
   retval = mysql_send_query(db, str, len);
 
   CHECK_AND_RAISE(retval, query);
+}
 
-  int socket_fd = db->net.fd;
-  fd_set rset;
+// The timeout is given when the query was killed because of it, and is
+// raised as a QueryTimeoutError, unless the query was done before the kill.
+MYSQL_RES *do_mysql_read_result(VALUE self, VALUE connection, MYSQL *db, VALUE query, struct timeval *start, double timeout) {
+  int retval = mysql_read_query_result(db);
 
-  while (1) {
-    FD_ZERO(&rset);
-    FD_SET(socket_fd, &rset);
+  if (retval != 0 && timeout > 0 && mysql_errno(db) == ER_QUERY_INTERRUPTED) {
+    data_objects_raise_query_timeout(self, timeout, query);
+  }
 
-    retval = rb_thread_select(socket_fd + 1, &rset, NULL, NULL, NULL);
+  CHECK_AND_RAISE(retval, query);
+  data_objects_debug(connection, query, start);
 
-    if (retval < 0) {
-      rb_sys_fail(0);
-    }
+  MYSQL_RES *result = mysql_store_result(db);
+
+  if (!result) {
+    CHECK_AND_RAISE(mysql_errno(db), query);
+  }
+
+  return result;
+}
+
+// The arguments of do_mysql_kill_query_run
+struct do_mysql_kill_query {
+  VALUE connection;
+  unsigned long thread_id;
+  VALUE killer;
+};
+
+VALUE do_mysql_kill_query_dispose(VALUE data) {
+  struct do_mysql_kill_query *kill = (struct do_mysql_kill_query *)data;
+
+  if (kill->killer != Qnil) {
+    rb_funcall(kill->killer, rb_intern("dispose"), 0);
+  }
+
+  return Qnil;
+}
+
+VALUE do_mysql_kill_query_execute(VALUE data) {
+  struct do_mysql_kill_query *kill = (struct do_mysql_kill_query *)data;
+  char sql[64];
+
+  snprintf(sql, sizeof(sql), "KILL QUERY %lu", kill->thread_id);
+
+  VALUE uri = rb_iv_get(kill->connection, "@uri");
+
+  // Connection.new would check one out of the pool, and never give it back
+  kill->killer = rb_obj_alloc(rb_obj_class(kill->connection));
+  rb_obj_call_init(kill->killer, 1, &uri);
+
+  // Sent straight to the server rather than with a Command, which would
+  // wait for the ConcurrencyLimiter and get the query_timeout of the URI
+  MYSQL *db = DATA_PTR(rb_iv_get(kill->killer, "@connection"));
+
+  if (mysql_send_query(db, sql, strlen(sql)) != 0) {
+    rb_raise(eConnectionError, "%s", mysql_error(db));
+  }
+
+  data_objects_wait_fd(kill->killer, db->net.fd, DO_WAIT_READABLE, NULL);
+
+  if (mysql_read_query_result(db) != 0) {
+    rb_raise(eConnectionError, "%s", mysql_error(db));
+  }
+
+  return Qnil;
+}
+
+VALUE do_mysql_kill_query_run(VALUE data) {
+  return rb_ensure(do_mysql_kill_query_execute, data, do_mysql_kill_query_dispose, data);
+}
+
+// MySQL can't cancel a query over the connection that runs it, so it's
+// killed from a second connection to the same URI. That one is opened
+// outside of the pool, and closed again right away.
+int do_mysql_kill_query(VALUE connection, MYSQL *db) {
+  struct do_mysql_kill_query kill;
+  int state = 0;
+
+  kill.connection = connection;
+  kill.thread_id = mysql_thread_id(db);
+  kill.killer = Qnil;
+
+  rb_protect(do_mysql_kill_query_run, (VALUE)&kill, &state);
+
+  if (state) {
+    // The error of the kill isn't raised, the query is waited for instead
+    rb_set_errinfo(Qnil);
+  }
+
+  return state == 0;
+}
+
+// Drops the result of a Command#send_reader that was never fetched, so the
+// connection can run another query. A query that's still running is killed,
+// and the other threads keep running while it winds down.
+void do_mysql_discard_pending(VALUE connection, MYSQL *db) {
+  struct timeval now = { 0, 0 };
+
+  if (rb_iv_get(connection, "@pending_command") == Qnil) {
+    return;
+  }
+
+  rb_iv_set(connection, "@pending_command", Qnil);
+
+  if (!data_objects_wait_fd(connection, db->net.fd, DO_WAIT_READABLE, &now)) {
+    do_mysql_kill_query(connection, db);
+  }
+
+  data_objects_wait_fd(connection, db->net.fd, DO_WAIT_READABLE, NULL);
 
-    if (retval == 0) {
+  if (mysql_read_query_result(db) == 0) {
+    mysql_free_result(mysql_store_result(db));
+  }
+}
+
+MYSQL_RES *do_mysql_cCommand_execute_async(VALUE self, VALUE connection, MYSQL *db, VALUE query) {
+  struct timeval start, deadline;
+  double timeout = data_objects_query_timeout(self);
+  int killed = 0;
+
+  gettimeofday(&start, NULL);
+
+  struct timeval *until = data_objects_deadline(timeout, &deadline);
+
+  do_mysql_send_query(self, connection, db, query);
+
+  while (1) {
+    if (!data_objects_wait_fd_until(connection, db->net.fd, DO_WAIT_READABLE, until)) {
+      // When the kill doesn't get through, the query is waited for
+      killed = do_mysql_kill_query(connection, db);
+      until = NULL;
       continue;
     }
 
@@ -175,20 +297,107 @@ MYSQL_RES *do_mysql_cCommand_execute_async(VALUE self, VALUE connection, MYSQL *
     }
   }
 
-  retval = mysql_read_query_result(db);
-  CHECK_AND_RAISE(retval, query);
-  data_objects_debug(connection, query, &start);
+  return do_mysql_read_result(self, connection, db, query, &start, killed ? timeout : 0);
+}
+#endif
 
-  MYSQL_RES *result = mysql_store_result(db);
+// The arguments of mysql_real_connect, see do_mysql_connect below
+struct do_mysql_connect {
+  VALUE connection;
+  MYSQL *db;
+  const char *host;
+  const char *user;
+  const char *password;
+  const char *database;
+  int port;
+  const char *socket;
+  unsigned long client_flags;
+  MYSQL *result;
+};
+
+#if defined(HAVE_MYSQL_REAL_CONNECT_START) && !defined(_WIN32)
+// With the non-blocking API of the MariaDB client library, waits for the
+// socket whenever the library would block.
+VALUE do_mysql_connect_run(VALUE data) {
+  struct do_mysql_connect *connect = (struct do_mysql_connect *)data;
+  struct timeval timeout;
+  int status;
+
+  status = mysql_real_connect_start(&connect->result, connect->db, connect->host, connect->user, connect->password,
+                                    connect->database, connect->port, connect->socket, connect->client_flags);
+
+  while (status) {
+    int events = 0;
+
+    if (status & MYSQL_WAIT_READ) {
+      events |= DO_WAIT_READABLE;
+    }
 
-  if (!result) {
-    CHECK_AND_RAISE(mysql_errno(db), query);
+    if (status & MYSQL_WAIT_WRITE) {
+      events |= DO_WAIT_WRITABLE;
+    }
+
+    timeout.tv_sec = mysql_get_timeout_value(connect->db);
+    timeout.tv_usec = 0;
+
+    int ready = data_objects_wait_fd(connect->connection, mysql_get_socket(connect->db), events, (status & MYSQL_WAIT_TIMEOUT) ? &timeout : NULL);
+
+    status = 0;
+
+    if (ready & DO_WAIT_READABLE) {
+      status |= MYSQL_WAIT_READ;
+    }
+
+    if (ready & DO_WAIT_WRITABLE) {
+      status |= MYSQL_WAIT_WRITE;
+    }
+
+    status = mysql_real_connect_cont(&connect->result, connect->db, status ? status : MYSQL_WAIT_TIMEOUT);
   }
 
-  return result;
+  return Qnil;
+}
+#else
+void *do_mysql_connect_blocking(void *data) {
+  struct do_mysql_connect *connect = data;
+
+  connect->result = mysql_real_connect(connect->db, connect->host, connect->user, connect->password,
+                                       connect->database, connect->port, connect->socket, connect->client_flags);
+  return NULL;
+}
+
+// Without the non-blocking API, the blocking connect runs without the GVL
+VALUE do_mysql_connect_run(VALUE data) {
+#ifdef HAVE_RB_THREAD_CALL_WITHOUT_GVL
+  rb_thread_call_without_gvl(do_mysql_connect_blocking, (void *)data, RUBY_UBF_IO, NULL);
+#else
+  do_mysql_connect_blocking((void *)data);
+#endif
+  return Qnil;
 }
 #endif
 
+// Connects without holding up other threads, or other fibers with the
+// MariaDB client library. The URI option connect_timeout limits how long it
+// takes. An exception raised into the waiting thread, like from Timeout or
+// Thread#kill, abandons the connection attempt.
+MYSQL *do_mysql_connect(struct do_mysql_connect *connect) {
+  int state = 0;
+
+  rb_protect(do_mysql_connect_run, (VALUE)connect, &state);
+
+  if (state) {
+    // A handle that's in use already is closed by dispose
+    if (rb_iv_get(connect->connection, "@connection") == Qnil) {
+      mysql_close(connect->db);
+    }
+
+    rb_jump_tag(state);
+  }
+
+  return connect->result;
+}
+
 void do_mysql_full_connect(VALUE self, MYSQL *db) {
   VALUE r_host = rb_iv_get(self, "@host");
   const char *host = "localhost";
@@ -269,18 +478,48 @@ void do_mysql_full_connect(VALUE self, MYSQL *db) {
   }
 #endif
 
-  unsigned long client_flags = 0;
+  // We only support encoding for MySQL versions providing mysql_set_character_set.
+  // Without this function there are potential issues with mysql_real_escape_string
+  // since that doesn't take the character set into consideration when setting it
+  // using a SET CHARACTER SET query. Since we don't want to stimulate these possible
+  // issues we simply ignore it and assume the user has configured this correctly.
+
+#ifdef HAVE_MYSQL_SET_CHARACTER_SET
+  // The connections character set is sent along with the handshake, which
+  // saves the round trip of mysql_set_character_set
+  VALUE encoding = rb_iv_get(self, "@encoding");
+  VALUE my_encoding = rb_hash_aref(data_objects_const_get(mEncoding, "MAP"), encoding);
+
+  if (my_encoding != Qnil) {
+    mysql_options(db, MYSQL_SET_CHARSET_NAME, rb_str_ptr_readonly(my_encoding));
+  }
+#endif
+
+  const char *connect_timeout = data_objects_get_uri_option(r_query, "connect_timeout");
 
-  MYSQL *result = mysql_real_connect(
-    db,
-    host,
-    user,
-    password,
-    database,
-    port,
-    socket,
-    client_flags
-  );
+  if (connect_timeout) {
+    unsigned int seconds = (unsigned int)ceil(atof(connect_timeout));
+    mysql_options(db, MYSQL_OPT_CONNECT_TIMEOUT, (const char *)&seconds);
+  }
+
+#if defined(HAVE_MYSQL_REAL_CONNECT_START) && !defined(_WIN32)
+  mysql_options(db, MYSQL_OPT_NONBLOCK, 0);
+#endif
+
+  struct do_mysql_connect connect;
+
+  connect.connection = self;
+  connect.db = db;
+  connect.host = host;
+  connect.user = user;
+  connect.password = password;
+  connect.database = database;
+  connect.port = port;
+  connect.socket = socket;
+  connect.client_flags = 0;
+  connect.result = NULL;
+
+  MYSQL *result = do_mysql_connect(&connect);
 
   if (!result) {
     do_mysql_raise_error(self, db, Qnil);
@@ -299,30 +538,13 @@ void do_mysql_full_connect(VALUE self, MYSQL *db) {
   mysql_options(db, MYSQL_OPT_RECONNECT, &reconnect);
 #endif
 
-  // We only support encoding for MySQL versions providing mysql_set_character_set.
-  // Without this function there are potential issues with mysql_real_escape_string
-  // since that doesn't take the character set into consideration when setting it
-  // using a SET CHARACTER SET query. Since we don't want to stimulate these possible
-  // issues we simply ignore it and assume the user has configured this correctly.
-
 #ifdef HAVE_MYSQL_SET_CHARACTER_SET
-  // Set the connections character set
-  VALUE encoding = rb_iv_get(self, "@encoding");
-  VALUE my_encoding = rb_hash_aref(data_objects_const_get(mEncoding, "MAP"), encoding);
-
   if (my_encoding != Qnil) {
-    int encoding_error = mysql_set_character_set(db, rb_str_ptr_readonly(my_encoding));
-
-    if (encoding_error != 0) {
-      do_mysql_raise_error(self, db, Qnil);
-    }
-    else {
 #ifdef HAVE_RUBY_ENCODING_H
-      rb_iv_set(self, "@encoding_id", INT2FIX(rb_enc_find_index(rb_str_ptr_readonly(encoding))));
+    rb_iv_set(self, "@encoding_id", INT2FIX(rb_enc_find_index(rb_str_ptr_readonly(encoding))));
 #endif
 
-      rb_iv_set(self, "@my_encoding", my_encoding);
-    }
+    rb_iv_set(self, "@my_encoding", my_encoding);
   }
   else {
     rb_warn("Encoding %s is not a known Ruby encoding for MySQL\n", rb_str_ptr_readonly(encoding));
@@ -334,22 +556,25 @@ void do_mysql_full_connect(VALUE self, MYSQL *db) {
   }
 #endif
 
-  // Disable sql_auto_is_null
-  do_mysql_cCommand_execute(Qnil, self, db, rb_str_new2("SET sql_auto_is_null = 0"));
+  // The session settings are made in a single statement, so they take one
+  // round trip. Disable sql_auto_is_null, and
   // removed NO_AUTO_VALUE_ON_ZERO because of MySQL bug http://bugs.mysql.com/bug.php?id=42270
   // added NO_BACKSLASH_ESCAPES so that backslashes should not be escaped as in other databases
+  const char *session = "SET sql_auto_is_null = 0";
 
 // For really anscient MySQL versions we don't attempt any strictness
 #ifdef HAVE_MYSQL_GET_SERVER_VERSION
   //4.x versions do not support certain session parameters
   if (mysql_get_server_version(db) < 50000) {
-    do_mysql_cCommand_execute(Qnil, self, db, rb_str_new2("SET SESSION sql_mode = 'ANSI,NO_DIR_IN_CREATE,NO_UNSIGNED_SUBTRACTION'"));
+    session = "SET sql_auto_is_null = 0, SESSION sql_mode = 'ANSI,NO_DIR_IN_CREATE,NO_UNSIGNED_SUBTRACTION'";
   }
   else {
-    do_mysql_cCommand_execute(Qnil, self, db, rb_str_new2("SET SESSION sql_mode = 'ANSI,NO_BACKSLASH_ESCAPES,NO_DIR_IN_CREATE,NO_ENGINE_SUBSTITUTION,NO_UNSIGNED_SUBTRACTION,TRADITIONAL'"));
+    session = "SET sql_auto_is_null = 0, SESSION sql_mode = 'ANSI,NO_BACKSLASH_ESCAPES,NO_DIR_IN_CREATE,NO_ENGINE_SUBSTITUTION,NO_UNSIGNED_SUBTRACTION,TRADITIONAL'";
   }
 #endif
 
+  do_mysql_cCommand_execute(Qnil, self, db, rb_str_new2(session));
+
   rb_iv_set(self, "@connection", Data_Wrap_Struct(rb_cObject, 0, 0, db));
 }
 
@@ -480,6 +705,10 @@ VALUE do_mysql_cCommand_execute_non_query(int argc, VALUE *argv, VALUE self) {
   VALUE query = data_objects_build_query_from_args(self, argc, argv);
   MYSQL_RES *response = do_mysql_cCommand_execute(self, connection, db, query);
 
+  return do_mysql_build_result(self, db, response);
+}
+
+VALUE do_mysql_build_result(VALUE self, MYSQL *db, MYSQL_RES *response) {
   my_ulonglong affected_rows = mysql_affected_rows(db);
   my_ulonglong insert_id = mysql_insert_id(db);
 
@@ -504,6 +733,17 @@ VALUE do_mysql_cCommand_execute_reader(int argc, VALUE *argv, VALUE self) {
   MYSQL *db = DATA_PTR(mysql_connection);
   MYSQL_RES *response = do_mysql_cCommand_execute(self, connection, db, query);
 
+  VALUE reader = do_mysql_build_reader(self, connection, db, response);
+
+  if (rb_block_given_p()) {
+    rb_yield(reader);
+    rb_funcall(reader, rb_intern("close"), 0);
+  }
+
+  return reader;
+}
+
+VALUE do_mysql_build_reader(VALUE self, VALUE connection, MYSQL *db, MYSQL_RES *response) {
   if (!response) {
     rb_raise(eConnectionError, "No result set received for a query that should yield one.");
   }
@@ -546,14 +786,360 @@ VALUE do_mysql_cCommand_execute_reader(int argc, VALUE *argv, VALUE self) {
 
   rb_iv_set(reader, "@fields", field_names);
   rb_iv_set(reader, "@field_types", field_types);
+  return reader;
+}
 
-  if (rb_block_given_p()) {
-    rb_yield(reader);
-    rb_funcall(reader, rb_intern("close"), 0);
+#if defined(HAVE_POLL) && !defined(_WIN32)
+// The state of Command.execute_readers, see below
+struct do_mysql_group {
+  long count;
+  int yield;
+  VALUE commands;
+  VALUE connections;
+  VALUE queries;
+  VALUE readers;
+  MYSQL **dbs;
+  struct timeval *starts;
+  struct pollfd *fds;
+  VALUE *owners;
+  long *indexes;
+  char *pending;
+  double *timeouts;
+  struct timeval *deadlines;
+  char *expired;
+  char *killed;
+};
+
+// The earliest deadline of the queries still running, NULL when none of
+// them has a timeout. The queries past it are killed.
+struct timeval *do_mysql_group_deadline(struct do_mysql_group *group) {
+  struct timeval *until = NULL;
+  long i;
+
+  for (i = 0; i < group->count; i++) {
+    if (!group->pending[i] || group->timeouts[i] <= 0 || group->expired[i]) {
+      continue;
+    }
+
+    struct timeval *deadline = &group->deadlines[i];
+
+    if (!until || deadline->tv_sec < until->tv_sec || (deadline->tv_sec == until->tv_sec && deadline->tv_usec < until->tv_usec)) {
+      until = deadline;
+    }
   }
 
-  return reader;
+  return until;
+}
+
+void do_mysql_group_kill_expired(struct do_mysql_group *group) {
+  long i;
+
+  for (i = 0; i < group->count; i++) {
+    if (group->pending[i] && group->timeouts[i] > 0 && !group->expired[i] && data_objects_deadline_passed(&group->deadlines[i])) {
+      // When the kill doesn't get through, the query is waited for
+      group->expired[i] = 1;
+      group->killed[i] = do_mysql_kill_query(rb_ary_entry(group->connections, i), group->dbs[i]);
+    }
+  }
+}
+
+VALUE do_mysql_group_run(VALUE data) {
+  struct do_mysql_group *group = (struct do_mysql_group *)data;
+  long remaining = group->count;
+  long i, waiting, ready;
+
+  for (i = 0; i < group->count; i++) {
+    gettimeofday(&group->starts[i], NULL);
+    group->timeouts[i] = data_objects_query_timeout(rb_ary_entry(group->commands, i));
+    data_objects_deadline(group->timeouts[i], &group->deadlines[i]);
+    do_mysql_send_query(rb_ary_entry(group->commands, i), rb_ary_entry(group->connections, i), group->dbs[i], rb_ary_entry(group->queries, i));
+    group->pending[i] = 1;
+  }
+
+  while (remaining > 0) {
+    waiting = 0;
+
+    for (i = 0; i < group->count; i++) {
+      if (group->pending[i]) {
+        group->fds[waiting].fd = group->dbs[i]->net.fd;
+        group->fds[waiting].events = POLLIN;
+        group->fds[waiting].revents = 0;
+        group->owners[waiting] = rb_ary_entry(group->connections, i);
+        group->indexes[waiting++] = i;
+      }
+    }
+
+    if (data_objects_poll(group->owners, group->fds, waiting, do_mysql_group_deadline(group)) == 0) {
+      do_mysql_group_kill_expired(group);
+      continue;
+    }
+
+    for (ready = 0; ready < waiting; ready++) {
+      if (!group->fds[ready].revents) {
+        continue;
+      }
+
+      i = group->indexes[ready];
+      group->pending[i] = 0;
+      remaining--;
+
+      VALUE command = rb_ary_entry(group->commands, i);
+      VALUE connection = rb_ary_entry(group->connections, i);
+      MYSQL *db = group->dbs[i];
+      VALUE query = rb_ary_entry(group->queries, i);
+      MYSQL_RES *response = do_mysql_read_result(command, connection, db, query, &group->starts[i], group->killed[i] ? group->timeouts[i] : 0);
+      VALUE reader = do_mysql_build_reader(command, connection, db, response);
+
+      if (group->yield) {
+        rb_yield_values(2, command, reader);
+      }
+      else {
+        rb_ary_store(group->readers, i, reader);
+      }
+    }
+  }
+
+  return group->yield ? Qnil : group->readers;
+}
+
+// Waits for the queries still running after an error and discards their
+// results, so their connections can be used again.
+VALUE do_mysql_group_cleanup(VALUE data) {
+  struct do_mysql_group *group = (struct do_mysql_group *)data;
+  MYSQL_RES *response;
+  long i;
+
+  for (i = 0; i < group->count; i++) {
+    if (!group->pending[i]) {
+      continue;
+    }
+
+    data_objects_wait_fd(rb_ary_entry(group->connections, i), group->dbs[i]->net.fd, DO_WAIT_READABLE, NULL);
+
+    if (mysql_read_query_result(group->dbs[i]) == 0 && (response = mysql_store_result(group->dbs[i]))) {
+      mysql_free_result(response);
+    }
+  }
+
+  return Qnil;
 }
+#endif
+
+/*
+ * Runs every command at the same time, each on its own connection, and
+ * waits for all of them in one loop instead of a thread per command. Pass
+ * a Command, or an Array of a Command and its bind values, for each query.
+ *
+ * Yields every command with its Reader as soon as it's done, or returns
+ * the Readers in the order of the commands without a block. When a query
+ * fails, the ones still running are waited for and its error is raised.
+ */
+VALUE do_mysql_cCommand_s_execute_readers(int argc, VALUE *argv, VALUE klass) {
+  VALUE commands = rb_ary_new2(argc);
+  VALUE connections = rb_ary_new2(argc);
+  VALUE queries = rb_ary_new2(argc);
+  int i;
+
+  for (i = 0; i < argc; i++) {
+    VALUE command = argv[i];
+    VALUE args = rb_ary_new();
+
+    if (TYPE(command) == T_ARRAY) {
+      args = rb_ary_dup(command);
+      command = rb_ary_shift(args);
+    }
+
+    if (!rb_obj_is_kind_of(command, cMysqlCommand)) {
+      rb_raise(rb_eArgError, "Expected a DataObjects::Mysql::Command, got %s", rb_obj_classname(command));
+    }
+
+    VALUE connection = rb_iv_get(command, "@connection");
+
+    if (rb_iv_get(connection, "@connection") == Qnil) {
+      rb_raise(eConnectionError, "This connection has already been closed.");
+    }
+
+    if (RTEST(rb_ary_includes(connections, connection))) {
+      rb_raise(rb_eArgError, "Every command needs a connection of its own");
+    }
+
+    rb_ary_push(commands, command);
+    rb_ary_push(connections, connection);
+    rb_ary_push(queries, data_objects_build_query_from_args(command, RARRAY_LEN(args), RARRAY_PTR(args)));
+  }
+
+#if defined(HAVE_POLL) && !defined(_WIN32)
+  struct do_mysql_group group;
+
+  group.count = argc;
+  group.yield = rb_block_given_p();
+  group.commands = commands;
+  group.connections = connections;
+  group.queries = queries;
+  group.readers = rb_ary_new2(argc);
+  group.dbs = ALLOCA_N(MYSQL *, argc);
+  group.starts = ALLOCA_N(struct timeval, argc);
+  group.fds = ALLOCA_N(struct pollfd, argc);
+  group.owners = ALLOCA_N(VALUE, argc);
+  group.indexes = ALLOCA_N(long, argc);
+  group.pending = ALLOCA_N(char, argc);
+  group.timeouts = ALLOCA_N(double, argc);
+  group.deadlines = ALLOCA_N(struct timeval, argc);
+  group.expired = ALLOCA_N(char, argc);
+  group.killed = ALLOCA_N(char, argc);
+
+  MEMZERO(group.pending, char, argc);
+  MEMZERO(group.expired, char, argc);
+  MEMZERO(group.killed, char, argc);
+
+  for (i = 0; i < argc; i++) {
+    group.dbs[i] = DATA_PTR(rb_iv_get(rb_ary_entry(connections, i), "@connection"));
+  }
+
+  return rb_ensure(do_mysql_group_run, (VALUE)&group, do_mysql_group_cleanup, (VALUE)&group);
+#else
+  // One after the other where there's no poll(2)
+  VALUE readers = rb_ary_new2(argc);
+
+  for (i = 0; i < argc; i++) {
+    VALUE command = rb_ary_entry(commands, i);
+    VALUE connection = rb_ary_entry(connections, i);
+    MYSQL *db = DATA_PTR(rb_iv_get(connection, "@connection"));
+    MYSQL_RES *response = do_mysql_cCommand_execute(command, connection, db, rb_ary_entry(queries, i));
+    VALUE reader = do_mysql_build_reader(command, connection, db, response);
+
+    if (rb_block_given_p()) {
+      rb_yield_values(2, command, reader);
+    }
+    else {
+      rb_ary_push(readers, reader);
+    }
+  }
+
+  return rb_block_given_p() ? Qnil : readers;
+#endif
+}
+
+#ifndef _WIN32
+/*
+ * The non-blocking API, for event loops that wait for the socket themselves:
+ *
+ *   command.send_reader(*args)
+ *   connection.socket_io.wait_readable
+ *   reader = connection.get_result
+ *
+ * Only one query can be sent on a connection at a time. get_result waits for
+ * whatever is still missing, so it can be called right away too. The MySQL
+ * client library can't send or read partially: send_reader only returns once
+ * the query went out, so flush is always true, and get_result reads the rest
+ * of the response once its first bytes arrived. consume_input has nothing to
+ * do, and busy? tells whether the response started arriving.
+ */
+MYSQL *do_mysql_get_db(VALUE connection) {
+  VALUE mysql_connection = rb_iv_get(connection, "@connection");
+
+  if (mysql_connection == Qnil) {
+    rb_raise(eConnectionError, "This connection has already been closed.");
+  }
+
+  return DATA_PTR(mysql_connection);
+}
+
+VALUE do_mysql_send_command(int argc, VALUE *argv, VALUE self, VALUE reader) {
+  VALUE connection = rb_iv_get(self, "@connection");
+  MYSQL *db = do_mysql_get_db(connection);
+
+  if (rb_iv_get(connection, "@pending_command") != Qnil) {
+    rb_raise(eConnectionError, "The result of the query sent before hasn't been fetched with get_result yet.");
+  }
+
+  VALUE query = data_objects_build_query_from_args(self, argc, argv);
+  struct timeval start;
+
+  gettimeofday(&start, NULL);
+  do_mysql_send_query(self, connection, db, query);
+
+  rb_iv_set(connection, "@pending_command", self);
+  rb_iv_set(connection, "@pending_query", query);
+  rb_iv_set(connection, "@pending_reader", reader);
+  rb_iv_set(connection, "@pending_start", rb_time_new(start.tv_sec, start.tv_usec));
+  return Qtrue;
+}
+
+VALUE do_mysql_cCommand_send_reader(int argc, VALUE *argv, VALUE self) {
+  return do_mysql_send_command(argc, argv, self, Qtrue);
+}
+
+VALUE do_mysql_cCommand_send_non_query(int argc, VALUE *argv, VALUE self) {
+  return do_mysql_send_command(argc, argv, self, Qfalse);
+}
+
+VALUE do_mysql_cConnection_socket_io(VALUE self) {
+  return data_objects_socket_io(self, do_mysql_get_db(self)->net.fd);
+}
+
+VALUE do_mysql_cConnection_flush(VALUE self) {
+  do_mysql_get_db(self);
+  return Qtrue;
+}
+
+VALUE do_mysql_cConnection_consume_input(VALUE self) {
+  do_mysql_get_db(self);
+  return Qtrue;
+}
+
+VALUE do_mysql_cConnection_is_busy(VALUE self) {
+  MYSQL *db = do_mysql_get_db(self);
+
+  if (rb_iv_get(self, "@pending_command") == Qnil) {
+    return Qfalse;
+  }
+
+#ifdef HAVE_POLL
+  struct pollfd fd;
+
+  fd.fd = db->net.fd;
+  fd.events = POLLIN;
+  fd.revents = 0;
+
+  return poll(&fd, 1, 0) > 0 ? Qfalse : Qtrue;
+#else
+  return Qfalse;
+#endif
+}
+
+VALUE do_mysql_cConnection_get_result(VALUE self) {
+  MYSQL *db = do_mysql_get_db(self);
+  VALUE command = rb_iv_get(self, "@pending_command");
+
+  if (command == Qnil) {
+    return Qnil;
+  }
+
+  data_objects_wait_fd(self, db->net.fd, DO_WAIT_READABLE, NULL);
+
+  VALUE query = rb_iv_get(self, "@pending_query");
+  struct timeval start = rb_time_timeval(rb_iv_get(self, "@pending_start"));
+
+  rb_iv_set(self, "@pending_command", Qnil);
+
+  MYSQL_RES *response = do_mysql_read_result(command, self, db, query, &start, 0);
+
+  if (RTEST(rb_iv_get(self, "@pending_reader"))) {
+    return do_mysql_build_reader(command, self, db, response);
+  }
+
+  return do_mysql_build_result(command, db, response);
+}
+
+VALUE do_mysql_cConnection_discard_pending(VALUE self) {
+  if (rb_iv_get(self, "@connection") != Qnil) {
+    do_mysql_discard_pending(self, do_mysql_get_db(self));
+  }
+
+  return Qnil;
+}
+#endif
 
 // This should be called to ensure that the internal result reader is freed
 VALUE do_mysql_cReader_close(VALUE self) {
@@ -639,11 +1225,24 @@ void Init_do_mysql() {
   rb_define_method(cMysqlConnection, "quote_date", data_objects_cConnection_quote_date, 1);
   rb_define_method(cMysqlConnection, "quote_time", data_objects_cConnection_quote_time, 1);
   rb_define_method(cMysqlConnection, "quote_datetime", data_objects_cConnection_quote_date_time, 1);
+#ifndef _WIN32
+  rb_define_method(cMysqlConnection, "socket_io", do_mysql_cConnection_socket_io, 0);
+  rb_define_method(cMysqlConnection, "flush", do_mysql_cConnection_flush, 0);
+  rb_define_method(cMysqlConnection, "consume_input", do_mysql_cConnection_consume_input, 0);
+  rb_define_method(cMysqlConnection, "busy?", do_mysql_cConnection_is_busy, 0);
+  rb_define_method(cMysqlConnection, "get_result", do_mysql_cConnection_get_result, 0);
+  rb_define_private_method(cMysqlConnection, "discard_pending", do_mysql_cConnection_discard_pending, 0);
+#endif
 
   cMysqlCommand = rb_define_class_under(mMysql, "Command", cDO_Command);
   rb_define_method(cMysqlCommand, "set_types", data_objects_cCommand_set_types, -1);
   rb_define_method(cMysqlCommand, "execute_non_query", do_mysql_cCommand_execute_non_query, -1);
   rb_define_method(cMysqlCommand, "execute_reader", do_mysql_cCommand_execute_reader, -1);
+  rb_define_singleton_method(cMysqlCommand, "execute_readers", do_mysql_cCommand_s_execute_readers, -1);
+#ifndef _WIN32
+  rb_define_method(cMysqlCommand, "send_reader", do_mysql_cCommand_send_reader, -1);
+  rb_define_method(cMysqlCommand, "send_non_query", do_mysql_cCommand_send_non_query, -1);
+#endif
 
   // Non-Query result
   cMysqlResult = rb_define_class_under(mMysql, "Result", cDO_Result);
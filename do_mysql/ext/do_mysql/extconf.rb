@@ -70,6 +70,17 @@ end
 have_func('localtime_r')
 have_func('gmtime_r')
 
+have_header 'ruby/thread.h'
+have_header 'ruby/io.h'
+have_header 'ruby/fiber/scheduler.h'
+have_func 'poll', 'poll.h'
+have_func 'rb_thread_call_without_gvl'
+have_func 'rb_thread_blocking_region'
+have_func 'rb_thread_check_ints'
+have_func 'rb_io_wait', 'ruby/io.h'
+have_func 'rb_wait_for_single_fd', 'ruby/io.h'
+have_func 'rb_fiber_scheduler_current', 'ruby/fiber/scheduler.h'
+
 have_header 'mysql.h'
 have_const 'MYSQL_TYPE_STRING', 'mysql.h'
 have_const 'MYSQL_TYPE_BIT', 'mysql.h'
@@ -80,6 +91,7 @@ have_func 'mysql_sqlstate', 'mysql.h'
 have_func 'mysql_get_ssl_cipher', 'mysql.h'
 have_func 'mysql_set_character_set', 'mysql.h'
 have_func 'mysql_get_server_version', 'mysql.h'
+have_func 'mysql_real_connect_start', 'mysql.h'
 have_struct_member 'MYSQL_FIELD', 'charsetnr', 'mysql.h'
 
 unless DateTime.respond_to?(:new!)
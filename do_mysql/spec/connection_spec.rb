@@ -18,6 +18,7 @@ describe DataObjects::Mysql::Connection do
 
   it_should_behave_like 'a Connection'
   it_should_behave_like 'a Connection with authentication support'
+  it_should_behave_like 'a Connection with connect timeouts' unless JRUBY
   it_should_behave_like 'a Connection with JDBC URL support' if JRUBY
   it_should_behave_like 'a Connection with SSL support' unless JRUBY
   it_should_behave_like 'a Connection via JDNI' if JRUBY
@@ -23,6 +23,7 @@ require 'data_objects'
 require 'data_objects/spec/setup'
 require 'data_objects/spec/lib/ssl'
 require 'data_objects/spec/lib/pending_helpers'
+require 'data_objects/spec/lib/fiber_scheduler'
 require 'do_mysql'
 
 DataObjects::Mysql.logger = DataObjects::Logger.new(STDOUT, :off)
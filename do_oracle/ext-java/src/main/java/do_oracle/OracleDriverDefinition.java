@@ -272,16 +272,18 @@ public class OracleDriverDefinition extends AbstractDriverDefinition {
     @Override
     public void afterConnectionCallback(IRubyObject doConn, Connection conn, Map<String, String> query)
             throws SQLException {
-        exec(conn, "alter session set nls_date_format = 'YYYY-MM-DD HH24:MI:SS'");
-        exec(conn, "alter session set nls_timestamp_format = 'YYYY-MM-DD HH24:MI:SS.FF'");
-        exec(conn, "alter session set nls_timestamp_tz_format = 'YYYY-MM-DD HH24:MI:SS.FF TZH:TZM'");
+        // ALTER SESSION takes several parameters, so they're all set in one round trip
+        String alterSession = "alter session set nls_date_format = 'YYYY-MM-DD HH24:MI:SS'"
+            + " nls_timestamp_format = 'YYYY-MM-DD HH24:MI:SS.FF'"
+            + " nls_timestamp_tz_format = 'YYYY-MM-DD HH24:MI:SS.FF TZH:TZM'";
         String time_zone = null;
         if (query != null)
             time_zone = query.get("time_zone");
         if (time_zone == null)
             time_zone = System.getenv("TZ");
         if (time_zone != null)
-            exec(conn, "alter session set time_zone = '"+time_zone+"'");
+            alterSession += " time_zone = '"+time_zone+"'";
+        exec(conn, alterSession);
     }
 
     /**
@@ -459,7 +459,7 @@ static VALUE cConnection_initialize(VALUE self, VALUE uri) {
   VALUE r_query, r_time_zone;
   char *non_blocking = NULL;
   char *time_zone = NULL;
-  char set_time_zone_command[80];
+  VALUE alter_session;
 
   char *host = "localhost", *port = "1521", *path = NULL;
   char *connect_string;
@@ -527,14 +527,16 @@ static VALUE cConnection_initialize(VALUE self, VALUE uri) {
     if (!NIL_P(r_time_zone))
       time_zone = StringValuePtr(r_time_zone);
   }
+  // ALTER SESSION takes several parameters, so they're all set in one round trip
+  alter_session = RUBY_STRING("alter session set nls_date_format = 'YYYY-MM-DD HH24:MI:SS'"
+    " nls_timestamp_format = 'YYYY-MM-DD HH24:MI:SS.FF'"
+    " nls_timestamp_tz_format = 'YYYY-MM-DD HH24:MI:SS.FF TZH:TZM'");
   if (time_zone) {
-    snprintf(set_time_zone_command, 80, "alter session set time_zone = '%s'", time_zone);
-    execute_sql(self, RUBY_STRING(set_time_zone_command));
+    rb_str_cat2(alter_session, " time_zone = '");
+    rb_str_cat2(alter_session, time_zone);
+    rb_str_cat2(alter_session, "'");
   }
-
-  execute_sql(self, RUBY_STRING("alter session set nls_date_format = 'YYYY-MM-DD HH24:MI:SS'"));
-  execute_sql(self, RUBY_STRING("alter session set nls_timestamp_format = 'YYYY-MM-DD HH24:MI:SS.FF'"));
-  execute_sql(self, RUBY_STRING("alter session set nls_timestamp_tz_format = 'YYYY-MM-DD HH24:MI:SS.FF TZH:TZM'"));
+  execute_sql(self, alter_session);
 
   return Qtrue;
 }
@@ -50,6 +50,8 @@ VALUE cPostgresResult;
 VALUE cPostgresReader;
 
 void do_postgres_full_connect(VALUE self, PGconn *db);
+VALUE do_postgres_build_reader(VALUE self, VALUE connection, VALUE query, PGresult *response);
+VALUE do_postgres_build_result(VALUE self, VALUE query, PGresult *response);
 
 /* ===== Typecasting Functions ===== */
 
@@ -236,19 +238,80 @@ PGresult * do_postgres_cCommand_execute_sync(VALUE self, VALUE connection, PGcon
   return response;
 }
 #else
-PGresult * do_postgres_cCommand_execute_async(VALUE self, VALUE connection, PGconn *db, VALUE query) {
+// Connections are non-blocking, so a large query may not go out in one go.
+// Sends the rest, waiting for the socket in the meantime.
+void do_postgres_flush(VALUE connection, PGconn *db) {
+  int retval;
+
+  while ((retval = PQflush(db)) == 1) {
+    data_objects_wait_fd(connection, PQsocket(db), DO_WAIT_READABLE | DO_WAIT_WRITABLE, NULL);
+
+    // The server may answer before it has read everything
+    if (PQconsumeInput(db) == 0) {
+      rb_raise(eConnectionError, "%s", PQerrorMessage(db));
+    }
+  }
+
+  if (retval < 0) {
+    rb_raise(eConnectionError, "%s", PQerrorMessage(db));
+  }
+}
+
+// Asks the server to cancel the running query. It answers the query with
+// an error then, or with its result when it was done already.
+int do_postgres_cancel(PGconn *db) {
+  char message[256];
+  PGcancel *cancel = PQgetCancel(db);
+  int retval;
+
+  if (!cancel) {
+    return 0;
+  }
+
+  retval = PQcancel(cancel, message, sizeof(message));
+  PQfreeCancel(cancel);
+  return retval;
+}
+
+// Drops the result of a Command#send_reader that was never fetched, so the
+// connection can run another query. A query that's still running is
+// cancelled, and the other threads keep running while it winds down.
+void do_postgres_discard_pending(VALUE connection, PGconn *db) {
   PGresult *response;
-  char* str = StringValuePtr(query);
 
-  while ((response = PQgetResult(db))) {
+  if (rb_iv_get(connection, "@pending_command") != Qnil) {
+    rb_iv_set(connection, "@pending_command", Qnil);
+    do_postgres_flush(connection, db);
+
+    if (PQconsumeInput(db) && PQisBusy(db)) {
+      do_postgres_cancel(db);
+    }
+  }
+
+  while (1) {
+    while (PQisBusy(db)) {
+      data_objects_wait_fd(connection, PQsocket(db), DO_WAIT_READABLE, NULL);
+
+      // A broken connection is reset when the next query is sent
+      if (PQconsumeInput(db) == 0) {
+        break;
+      }
+    }
+
+    if (!(response = PQgetResult(db))) {
+      break;
+    }
+
     PQclear(response);
   }
+}
 
-  struct timeval start;
-  int retval;
+void do_postgres_send_query(VALUE connection, PGconn *db, VALUE query) {
+  char* str = StringValuePtr(query);
 
-  gettimeofday(&start, NULL);
-  retval = PQsendQuery(db, str);
+  do_postgres_discard_pending(connection, db);
+
+  int retval = PQsendQuery(db, str);
 
   if (!retval) {
     if (PQstatus(db) != CONNECTION_OK) {
@@ -267,20 +330,39 @@ PGresult * do_postgres_cCommand_execute_async(VALUE self, VALUE connection, PGco
       rb_raise(eConnectionError, "%s", PQerrorMessage(db));
     }
   }
+}
 
-  int socket_fd = PQsocket(db);
-  fd_set rset;
-
-  while (1) {
-    FD_ZERO(&rset);
-    FD_SET(socket_fd, &rset);
-    retval = rb_thread_select(socket_fd + 1, &rset, NULL, NULL, NULL);
+// Raises a QueryTimeoutError for the result of a query cancelled because of
+// its timeout, unless it was done before the cancel request got there.
+void do_postgres_check_cancelled(VALUE self, PGresult *response, double timeout, VALUE query) {
+  if (PQresultStatus(response) == PGRES_FATAL_ERROR) {
+    const char *sql_state = PQresultErrorField(response, PG_DIAG_SQLSTATE);
 
-    if (retval < 0) {
-      rb_sys_fail(0);
+    // query_canceled, the rest of the results is dropped by the next query
+    if (sql_state && strcmp(sql_state, "57014") == 0) {
+      PQclear(response);
+      data_objects_raise_query_timeout(self, timeout, query);
     }
+  }
+}
+
+PGresult * do_postgres_cCommand_execute_async(VALUE self, VALUE connection, PGconn *db, VALUE query) {
+  struct timeval start, deadline;
+  double timeout = data_objects_query_timeout(self);
+  int cancelled = 0;
+
+  gettimeofday(&start, NULL);
+
+  struct timeval *until = data_objects_deadline(timeout, &deadline);
 
-    if (retval == 0) {
+  do_postgres_send_query(connection, db, query);
+  do_postgres_flush(connection, db);
+
+  while (1) {
+    if (!data_objects_wait_fd_until(connection, PQsocket(db), DO_WAIT_READABLE, until)) {
+      // Without a cancel request getting through, the query is waited for
+      cancelled = do_postgres_cancel(db);
+      until = NULL;
       continue;
     }
 
@@ -294,7 +376,14 @@ PGresult * do_postgres_cCommand_execute_async(VALUE self, VALUE connection, PGco
   }
 
   data_objects_debug(connection, query, &start);
-  return PQgetResult(db);
+
+  PGresult *response = PQgetResult(db);
+
+  if (cancelled) {
+    do_postgres_check_cancelled(self, response, timeout, query);
+  }
+
+  return response;
 }
 #endif
 
@@ -356,6 +445,139 @@ VALUE do_postgres_cConnection_initialize(VALUE self, VALUE uri) {
   return Qtrue;
 }
 
+#if defined(HAVE_PQCONNECTSTARTPARAMS) && !defined(_WIN32)
+// Whether this version of libpq knows the connection option
+int do_postgres_has_connect_option(const char *keyword) {
+  PQconninfoOption *defaults = PQconndefaults();
+  PQconninfoOption *option;
+  int found = 0;
+
+  for (option = defaults; option && option->keyword; option++) {
+    if (strcmp(option->keyword, keyword) == 0) {
+      found = 1;
+      break;
+    }
+  }
+
+  PQconninfoFree(defaults);
+  return found;
+}
+
+// The state of an asynchronous connect, see do_postgres_connect below
+struct do_postgres_connect {
+  VALUE connection;
+  const char **keywords;
+  const char **values;
+  double timeout;
+  PGconn *db;
+  PostgresPollingStatusType status;
+};
+
+void *do_postgres_connect_start(void *data) {
+  struct do_postgres_connect *connect = data;
+
+  connect->db = PQconnectStartParams(connect->keywords, connect->values, 0);
+  return NULL;
+}
+
+void *do_postgres_connect_poll(void *data) {
+  struct do_postgres_connect *connect = data;
+
+  connect->status = PQconnectPoll(connect->db);
+  return NULL;
+}
+
+// libpq may look up the host name in either of them, which blocks
+void do_postgres_connect_without_gvl(void *(*function)(void *), struct do_postgres_connect *connect) {
+#ifdef HAVE_RB_THREAD_CALL_WITHOUT_GVL
+  rb_thread_call_without_gvl(function, connect, RUBY_UBF_IO, NULL);
+#else
+  function(connect);
+#endif
+}
+
+// Drives PQconnectPoll, waiting for the socket in between. Returns Qfalse
+// when the timeout passed.
+VALUE do_postgres_connect_run(VALUE data) {
+  struct do_postgres_connect *connect = (struct do_postgres_connect *)data;
+  struct timeval deadline, now, remaining;
+
+  gettimeofday(&deadline, NULL);
+  deadline.tv_sec += (long)connect->timeout;
+  deadline.tv_usec += (long)((connect->timeout - (long)connect->timeout) * 1000000);
+
+  if (deadline.tv_usec >= 1000000) {
+    deadline.tv_sec++;
+    deadline.tv_usec -= 1000000;
+  }
+
+  do_postgres_connect_without_gvl(do_postgres_connect_start, connect);
+
+  if (!connect->db) {
+    rb_memerror();
+  }
+
+  if (PQstatus(connect->db) == CONNECTION_BAD) {
+    return Qtrue;
+  }
+
+  connect->status = PGRES_POLLING_WRITING;
+
+  while (connect->status != PGRES_POLLING_OK && connect->status != PGRES_POLLING_FAILED) {
+    int events = connect->status == PGRES_POLLING_READING ? DO_WAIT_READABLE : DO_WAIT_WRITABLE;
+
+    if (connect->timeout > 0) {
+      gettimeofday(&now, NULL);
+      timersub(&deadline, &now, &remaining);
+
+      if (remaining.tv_sec < 0) {
+        return Qfalse;
+      }
+    }
+
+    if (!data_objects_wait_fd(connect->connection, PQsocket(connect->db), events, connect->timeout > 0 ? &remaining : NULL)) {
+      return Qfalse;
+    }
+
+    do_postgres_connect_without_gvl(do_postgres_connect_poll, connect);
+  }
+
+  return Qtrue;
+}
+
+// Connects without holding up other threads or fibers, for at most +timeout+
+// seconds when it's positive. An exception raised into the waiting thread,
+// like from Timeout or Thread#kill, abandons the connection attempt.
+PGconn *do_postgres_connect(VALUE self, const char **keywords, const char **values, double timeout) {
+  struct do_postgres_connect connect;
+  VALUE connected;
+  int state = 0;
+
+  connect.connection = self;
+  connect.keywords = keywords;
+  connect.values = values;
+  connect.timeout = timeout;
+  connect.db = NULL;
+
+  connected = rb_protect(do_postgres_connect_run, (VALUE)&connect, &state);
+
+  if (state) {
+    if (connect.db) {
+      PQfinish(connect.db);
+    }
+
+    rb_jump_tag(state);
+  }
+
+  if (connected == Qfalse) {
+    PQfinish(connect.db);
+    rb_raise(eConnectionError, "Timed out connecting after %g seconds", timeout);
+  }
+
+  return connect.db;
+}
+#endif
+
 void do_postgres_full_connect(VALUE self, PGconn *db) {
   VALUE r_host;
   char *host = NULL;
@@ -401,91 +623,82 @@ void do_postgres_full_connect(VALUE self, PGconn *db) {
   VALUE r_query = rb_iv_get(self, "@query");
   const char *search_path = data_objects_get_uri_option(r_query, "search_path");
 
-  db = PQsetdbLogin(
-    host,
-    port,
-    NULL,
-    NULL,
-    database,
-    user,
-    password
-  );
-
-  if (PQstatus(db) == CONNECTION_BAD) {
-    rb_raise(eConnectionError, "%s", PQerrorMessage(db));
-  }
-
-  PGresult *result;
+  // The session settings go along with the startup packet, instead of
+  // taking a round trip each once connected
+  VALUE r_options = rb_str_new2("-c backslash_quote=off -c standard_conforming_strings=on -c client_min_messages=warning");
 
   if (search_path) {
-    char *search_path_query;
+    const char *c;
 
-    if (!(search_path_query = calloc(256, sizeof(char)))) {
-      rb_memerror();
-    }
+    rb_str_cat2(r_options, " -c search_path=");
 
-    snprintf(search_path_query, 256, "set search_path to %s;", search_path);
-
-    r_query = rb_str_new2(search_path_query);
-    result = do_postgres_cCommand_execute(Qnil, self, db, r_query);
+    for (c = search_path; *c; c++) {
+      // Spaces separate the options
+      if (*c == ' ' || *c == '\\') {
+        rb_str_cat(r_options, "\\", 1);
+      }
 
-    if (PQresultStatus(result) != PGRES_COMMAND_OK) {
-      free(search_path_query);
-      do_postgres_raise_error(self, result, r_query);
+      rb_str_cat(r_options, c, 1);
     }
-
-    free(search_path_query);
   }
 
-  const char *backslash_off = "SET backslash_quote = off";
-  const char *standard_strings_on = "SET standard_conforming_strings = on";
-  const char *warning_messages = "SET client_min_messages = warning";
-  VALUE r_options;
+  const char *options = StringValueCStr(r_options);
+  const char *client_encoding;
+  VALUE encoding = rb_iv_get(self, "@encoding");
+  VALUE pg_encoding = rb_hash_aref(data_objects_const_get(mEncoding, "MAP"), encoding);
 
-  r_options = rb_str_new2(backslash_off);
-  result = do_postgres_cCommand_execute(Qnil, self, db, r_options);
+  if (pg_encoding == Qnil) {
+    rb_warn("Encoding %s is not a known Ruby encoding for PostgreSQL\n", rb_str_ptr_readonly(encoding));
 
-  if (PQresultStatus(result) != PGRES_COMMAND_OK) {
-    rb_warn("%s", PQresultErrorMessage(result));
+    encoding = rb_str_new2("UTF-8");
+    pg_encoding = rb_str_new2("UTF8");
+    rb_iv_set(self, "@encoding", encoding);
   }
 
-  r_options = rb_str_new2(standard_strings_on);
-  result = do_postgres_cCommand_execute(Qnil, self, db, r_options);
+  client_encoding = rb_str_ptr_readonly(pg_encoding);
+
+#if defined(HAVE_PQCONNECTSTARTPARAMS) && !defined(_WIN32)
+  const char *connect_timeout = data_objects_get_uri_option(r_query, "connect_timeout");
+  const char *keywords[] = { "host", "port", "dbname", "user", "password", "options", "client_encoding", NULL };
+  const char *values[] = { host, port, database, user, password, options, client_encoding, NULL };
 
-  if (PQresultStatus(result) != PGRES_COMMAND_OK) {
-    rb_warn("%s", PQresultErrorMessage(result));
+  // Older versions of libpq set the encoding after connecting only
+  if (!do_postgres_has_connect_option("client_encoding")) {
+    keywords[6] = NULL;
+  }
+  else {
+    client_encoding = NULL;
   }
 
-  r_options = rb_str_new2(warning_messages);
-  result = do_postgres_cCommand_execute(Qnil, self, db, r_options);
+  db = do_postgres_connect(self, keywords, values, connect_timeout ? atof(connect_timeout) : 0);
+#else
+  db = PQsetdbLogin(
+    host,
+    port,
+    options,
+    NULL,
+    database,
+    user,
+    password
+  );
+#endif
 
-  if (PQresultStatus(result) != PGRES_COMMAND_OK) {
-    rb_warn("%s", PQresultErrorMessage(result));
+  if (PQstatus(db) == CONNECTION_BAD) {
+    rb_raise(eConnectionError, "%s", PQerrorMessage(db));
   }
 
-  VALUE encoding = rb_iv_get(self, "@encoding");
-#ifdef HAVE_PQSETCLIENTENCODING
-  VALUE pg_encoding = rb_hash_aref(data_objects_const_get(mEncoding, "MAP"), encoding);
-
-  if (pg_encoding != Qnil) {
-    if (PQsetClientEncoding(db, rb_str_ptr_readonly(pg_encoding))) {
-      rb_raise(eConnectionError, "Couldn't set encoding: %s", rb_str_ptr_readonly(encoding));
-    }
-    else {
-#ifdef HAVE_RUBY_ENCODING_H
-      rb_iv_set(self, "@encoding_id", INT2FIX(rb_enc_find_index(rb_str_ptr_readonly(encoding))));
-#endif
-      rb_iv_set(self, "@pg_encoding", pg_encoding);
-    }
+  if (client_encoding && PQsetClientEncoding(db, client_encoding)) {
+    rb_raise(eConnectionError, "Couldn't set encoding: %s", rb_str_ptr_readonly(encoding));
   }
-  else {
-    rb_warn("Encoding %s is not a known Ruby encoding for PostgreSQL\n", rb_str_ptr_readonly(encoding));
 
-    rb_iv_set(self, "@encoding", rb_str_new2("UTF-8"));
 #ifdef HAVE_RUBY_ENCODING_H
-    rb_iv_set(self, "@encoding_id", INT2FIX(rb_enc_find_index("UTF-8")));
+  rb_iv_set(self, "@encoding_id", INT2FIX(rb_enc_find_index(rb_str_ptr_readonly(encoding))));
 #endif
-    rb_iv_set(self, "@pg_encoding", rb_str_new2("UTF8"));
+  rb_iv_set(self, "@pg_encoding", pg_encoding);
+
+#ifndef _WIN32
+  if (PQsetnonblocking(db, 1) != 0) {
+    rb_raise(eConnectionError, "%s", PQerrorMessage(db));
   }
 #endif
 
@@ -502,11 +715,13 @@ VALUE do_postgres_cCommand_execute_non_query(int argc, VALUE *argv, VALUE self)
 
   VALUE query = data_objects_build_query_from_args(self, argc, argv);
   PGconn *db = DATA_PTR(postgres_connection);
-  PGresult *response;
-  int status;
+  PGresult *response = do_postgres_cCommand_execute(self, connection, db, query);
 
-  response = do_postgres_cCommand_execute(self, connection, db, query);
-  status = PQresultStatus(response);
+  return do_postgres_build_result(self, query, response);
+}
+
+VALUE do_postgres_build_result(VALUE self, VALUE query, PGresult *response) {
+  int status = PQresultStatus(response);
 
   VALUE affected_rows = Qnil;
   VALUE insert_id = Qnil;
@@ -545,6 +760,10 @@ VALUE do_postgres_cCommand_execute_reader(int argc, VALUE *argv, VALUE self) {
   PGconn *db = DATA_PTR(postgres_connection);
   PGresult *response = do_postgres_cCommand_execute(self, connection, db, query);
 
+  return do_postgres_build_reader(self, connection, query, response);
+}
+
+VALUE do_postgres_build_reader(VALUE self, VALUE connection, VALUE query, PGresult *response) {
   if (PQresultStatus(response) != PGRES_TUPLES_OK) {
     do_postgres_raise_error(self, response, query);
   }
@@ -589,6 +808,388 @@ VALUE do_postgres_cCommand_execute_reader(int argc, VALUE *argv, VALUE self) {
   return reader;
 }
 
+#if defined(HAVE_POLL) && !defined(_WIN32)
+// The state of Command.execute_readers, see below
+struct do_postgres_group {
+  long count;
+  int yield;
+  VALUE commands;
+  VALUE connections;
+  VALUE queries;
+  VALUE readers;
+  PGconn **dbs;
+  struct timeval *starts;
+  struct pollfd *fds;
+  VALUE *owners;
+  long *indexes;
+  char *pending;
+  double *timeouts;
+  struct timeval *deadlines;
+  char *expired;
+  char *cancelled;
+};
+
+// The earliest deadline of the queries still running, NULL when none of
+// them has a timeout. The queries past it are cancelled.
+struct timeval *do_postgres_group_deadline(struct do_postgres_group *group) {
+  struct timeval *until = NULL;
+  long i;
+
+  for (i = 0; i < group->count; i++) {
+    if (!group->pending[i] || group->timeouts[i] <= 0 || group->expired[i]) {
+      continue;
+    }
+
+    struct timeval *deadline = &group->deadlines[i];
+
+    if (!until || deadline->tv_sec < until->tv_sec || (deadline->tv_sec == until->tv_sec && deadline->tv_usec < until->tv_usec)) {
+      until = deadline;
+    }
+  }
+
+  return until;
+}
+
+void do_postgres_group_cancel_expired(struct do_postgres_group *group) {
+  long i;
+
+  for (i = 0; i < group->count; i++) {
+    if (group->pending[i] && group->timeouts[i] > 0 && !group->expired[i] && data_objects_deadline_passed(&group->deadlines[i])) {
+      // Without a cancel request getting through, the query is waited for
+      group->expired[i] = 1;
+      group->cancelled[i] = do_postgres_cancel(group->dbs[i]);
+    }
+  }
+}
+
+VALUE do_postgres_group_run(VALUE data) {
+  struct do_postgres_group *group = (struct do_postgres_group *)data;
+  long remaining = group->count;
+  long i, waiting, ready;
+
+  for (i = 0; i < group->count; i++) {
+    gettimeofday(&group->starts[i], NULL);
+    group->timeouts[i] = data_objects_query_timeout(rb_ary_entry(group->commands, i));
+    data_objects_deadline(group->timeouts[i], &group->deadlines[i]);
+    do_postgres_send_query(rb_ary_entry(group->connections, i), group->dbs[i], rb_ary_entry(group->queries, i));
+    do_postgres_flush(rb_ary_entry(group->connections, i), group->dbs[i]);
+    group->pending[i] = 1;
+  }
+
+  while (remaining > 0) {
+    waiting = 0;
+
+    for (i = 0; i < group->count; i++) {
+      if (group->pending[i]) {
+        group->fds[waiting].fd = PQsocket(group->dbs[i]);
+        group->fds[waiting].events = POLLIN;
+        group->fds[waiting].revents = 0;
+        group->owners[waiting] = rb_ary_entry(group->connections, i);
+        group->indexes[waiting++] = i;
+      }
+    }
+
+    if (data_objects_poll(group->owners, group->fds, waiting, do_postgres_group_deadline(group)) == 0) {
+      do_postgres_group_cancel_expired(group);
+      continue;
+    }
+
+    for (ready = 0; ready < waiting; ready++) {
+      if (!group->fds[ready].revents) {
+        continue;
+      }
+
+      i = group->indexes[ready];
+      PGconn *db = group->dbs[i];
+
+      if (PQconsumeInput(db) == 0) {
+        group->pending[i] = 0;
+        rb_raise(eConnectionError, "%s", PQerrorMessage(db));
+      }
+
+      if (PQisBusy(db)) {
+        continue;
+      }
+
+      group->pending[i] = 0;
+      remaining--;
+
+      VALUE command = rb_ary_entry(group->commands, i);
+      VALUE connection = rb_ary_entry(group->connections, i);
+      VALUE query = rb_ary_entry(group->queries, i);
+
+      data_objects_debug(connection, query, &group->starts[i]);
+
+      PGresult *response = PQgetResult(db);
+
+      if (group->cancelled[i]) {
+        do_postgres_check_cancelled(command, response, group->timeouts[i], query);
+      }
+
+      VALUE reader = do_postgres_build_reader(command, connection, query, response);
+
+      if (group->yield) {
+        rb_yield_values(2, command, reader);
+      }
+      else {
+        rb_ary_store(group->readers, i, reader);
+      }
+    }
+  }
+
+  return group->yield ? Qnil : group->readers;
+}
+
+// Cancels the queries still running after an error, so their connections
+// can be used again.
+VALUE do_postgres_group_cleanup(VALUE data) {
+  struct do_postgres_group *group = (struct do_postgres_group *)data;
+  PGresult *response;
+  PGcancel *cancel;
+  char error[256];
+  long i;
+
+  for (i = 0; i < group->count; i++) {
+    if (!group->pending[i]) {
+      continue;
+    }
+
+    if ((cancel = PQgetCancel(group->dbs[i]))) {
+      PQcancel(cancel, error, sizeof(error));
+      PQfreeCancel(cancel);
+    }
+
+    while ((response = PQgetResult(group->dbs[i]))) {
+      PQclear(response);
+    }
+  }
+
+  return Qnil;
+}
+#endif
+
+/*
+ * Runs every command at the same time, each on its own connection, and
+ * waits for all of them in one loop instead of a thread per command. Pass
+ * a Command, or an Array of a Command and its bind values, for each query.
+ *
+ * Yields every command with its Reader as soon as it's done, or returns
+ * the Readers in the order of the commands without a block. When a query
+ * fails, the ones still running are cancelled and its error is raised.
+ */
+VALUE do_postgres_cCommand_s_execute_readers(int argc, VALUE *argv, VALUE klass) {
+  VALUE commands = rb_ary_new2(argc);
+  VALUE connections = rb_ary_new2(argc);
+  VALUE queries = rb_ary_new2(argc);
+  int i;
+
+  for (i = 0; i < argc; i++) {
+    VALUE command = argv[i];
+    VALUE args = rb_ary_new();
+
+    if (TYPE(command) == T_ARRAY) {
+      args = rb_ary_dup(command);
+      command = rb_ary_shift(args);
+    }
+
+    if (!rb_obj_is_kind_of(command, cPostgresCommand)) {
+      rb_raise(rb_eArgError, "Expected a DataObjects::Postgres::Command, got %s", rb_obj_classname(command));
+    }
+
+    VALUE connection = rb_iv_get(command, "@connection");
+
+    if (rb_iv_get(connection, "@connection") == Qnil) {
+      rb_raise(eConnectionError, "This connection has already been closed.");
+    }
+
+    if (RTEST(rb_ary_includes(connections, connection))) {
+      rb_raise(rb_eArgError, "Every command needs a connection of its own");
+    }
+
+    rb_ary_push(commands, command);
+    rb_ary_push(connections, connection);
+    rb_ary_push(queries, data_objects_build_query_from_args(command, RARRAY_LEN(args), RARRAY_PTR(args)));
+  }
+
+#if defined(HAVE_POLL) && !defined(_WIN32)
+  struct do_postgres_group group;
+
+  group.count = argc;
+  group.yield = rb_block_given_p();
+  group.commands = commands;
+  group.connections = connections;
+  group.queries = queries;
+  group.readers = rb_ary_new2(argc);
+  group.dbs = ALLOCA_N(PGconn *, argc);
+  group.starts = ALLOCA_N(struct timeval, argc);
+  group.fds = ALLOCA_N(struct pollfd, argc);
+  group.owners = ALLOCA_N(VALUE, argc);
+  group.indexes = ALLOCA_N(long, argc);
+  group.pending = ALLOCA_N(char, argc);
+  group.timeouts = ALLOCA_N(double, argc);
+  group.deadlines = ALLOCA_N(struct timeval, argc);
+  group.expired = ALLOCA_N(char, argc);
+  group.cancelled = ALLOCA_N(char, argc);
+
+  MEMZERO(group.pending, char, argc);
+  MEMZERO(group.expired, char, argc);
+  MEMZERO(group.cancelled, char, argc);
+
+  for (i = 0; i < argc; i++) {
+    group.dbs[i] = DATA_PTR(rb_iv_get(rb_ary_entry(connections, i), "@connection"));
+  }
+
+  return rb_ensure(do_postgres_group_run, (VALUE)&group, do_postgres_group_cleanup, (VALUE)&group);
+#else
+  // One after the other where there's no poll(2)
+  VALUE readers = rb_ary_new2(argc);
+
+  for (i = 0; i < argc; i++) {
+    VALUE command = rb_ary_entry(commands, i);
+    VALUE connection = rb_ary_entry(connections, i);
+    VALUE query = rb_ary_entry(queries, i);
+    PGconn *db = DATA_PTR(rb_iv_get(connection, "@connection"));
+    VALUE reader = do_postgres_build_reader(command, connection, query, do_postgres_cCommand_execute(command, connection, db, query));
+
+    if (rb_block_given_p()) {
+      rb_yield_values(2, command, reader);
+    }
+    else {
+      rb_ary_push(readers, reader);
+    }
+  }
+
+  return rb_block_given_p() ? Qnil : readers;
+#endif
+}
+
+#ifndef _WIN32
+/*
+ * The non-blocking API, for event loops that wait for the socket themselves:
+ *
+ *   command.send_reader(*args)
+ *   connection.flush until ...           # true once the query went out
+ *   connection.socket_io.wait_readable
+ *   connection.consume_input
+ *   ... while connection.busy?
+ *   reader = connection.get_result
+ *
+ * Only one query can be sent on a connection at a time. get_result waits for
+ * whatever is still missing, so it can be called right away too.
+ */
+PGconn *do_postgres_get_db(VALUE connection) {
+  VALUE postgres_connection = rb_iv_get(connection, "@connection");
+
+  if (postgres_connection == Qnil) {
+    rb_raise(eConnectionError, "This connection has already been closed.");
+  }
+
+  return DATA_PTR(postgres_connection);
+}
+
+VALUE do_postgres_send_command(int argc, VALUE *argv, VALUE self, VALUE reader) {
+  VALUE connection = rb_iv_get(self, "@connection");
+  PGconn *db = do_postgres_get_db(connection);
+
+  if (rb_iv_get(connection, "@pending_command") != Qnil) {
+    rb_raise(eConnectionError, "The result of the query sent before hasn't been fetched with get_result yet.");
+  }
+
+  VALUE query = data_objects_build_query_from_args(self, argc, argv);
+  struct timeval start;
+
+  gettimeofday(&start, NULL);
+  do_postgres_send_query(connection, db, query);
+
+  if (PQflush(db) < 0) {
+    rb_raise(eConnectionError, "%s", PQerrorMessage(db));
+  }
+
+  rb_iv_set(connection, "@pending_command", self);
+  rb_iv_set(connection, "@pending_query", query);
+  rb_iv_set(connection, "@pending_reader", reader);
+  rb_iv_set(connection, "@pending_start", rb_time_new(start.tv_sec, start.tv_usec));
+  return Qtrue;
+}
+
+VALUE do_postgres_cCommand_send_reader(int argc, VALUE *argv, VALUE self) {
+  return do_postgres_send_command(argc, argv, self, Qtrue);
+}
+
+VALUE do_postgres_cCommand_send_non_query(int argc, VALUE *argv, VALUE self) {
+  return do_postgres_send_command(argc, argv, self, Qfalse);
+}
+
+VALUE do_postgres_cConnection_socket_io(VALUE self) {
+  return data_objects_socket_io(self, PQsocket(do_postgres_get_db(self)));
+}
+
+VALUE do_postgres_cConnection_flush(VALUE self) {
+  PGconn *db = do_postgres_get_db(self);
+  int retval = PQflush(db);
+
+  if (retval < 0) {
+    rb_raise(eConnectionError, "%s", PQerrorMessage(db));
+  }
+
+  return retval == 0 ? Qtrue : Qfalse;
+}
+
+VALUE do_postgres_cConnection_consume_input(VALUE self) {
+  PGconn *db = do_postgres_get_db(self);
+
+  if (PQconsumeInput(db) == 0) {
+    rb_raise(eConnectionError, "%s", PQerrorMessage(db));
+  }
+
+  return Qtrue;
+}
+
+VALUE do_postgres_cConnection_is_busy(VALUE self) {
+  return PQisBusy(do_postgres_get_db(self)) ? Qtrue : Qfalse;
+}
+
+VALUE do_postgres_cConnection_get_result(VALUE self) {
+  PGconn *db = do_postgres_get_db(self);
+  VALUE command = rb_iv_get(self, "@pending_command");
+
+  if (command == Qnil) {
+    return Qnil;
+  }
+
+  do_postgres_flush(self, db);
+
+  while (PQisBusy(db)) {
+    data_objects_wait_fd(self, PQsocket(db), DO_WAIT_READABLE, NULL);
+
+    if (PQconsumeInput(db) == 0) {
+      rb_raise(eConnectionError, "%s", PQerrorMessage(db));
+    }
+  }
+
+  VALUE query = rb_iv_get(self, "@pending_query");
+  struct timeval start = rb_time_timeval(rb_iv_get(self, "@pending_start"));
+  PGresult *response = PQgetResult(db);
+
+  rb_iv_set(self, "@pending_command", Qnil);
+  data_objects_debug(self, query, &start);
+
+  if (RTEST(rb_iv_get(self, "@pending_reader"))) {
+    return do_postgres_build_reader(command, self, query, response);
+  }
+
+  return do_postgres_build_result(command, query, response);
+}
+
+VALUE do_postgres_cConnection_discard_pending(VALUE self) {
+  if (rb_iv_get(self, "@connection") != Qnil) {
+    do_postgres_discard_pending(self, do_postgres_get_db(self));
+  }
+
+  return Qnil;
+}
+#endif
+
 VALUE do_postgres_cReader_close(VALUE self) {
   VALUE reader_container = rb_iv_get(self, "@reader");
 
@@ -677,11 +1278,24 @@ void Init_do_postgres() {
   rb_define_method(cPostgresConnection, "character_set", data_objects_cConnection_character_set , 0);
   rb_define_method(cPostgresConnection, "quote_string", do_postgres_cConnection_quote_string, 1);
   rb_define_method(cPostgresConnection, "quote_byte_array", do_postgres_cConnection_quote_byte_array, 1);
+#ifndef _WIN32
+  rb_define_method(cPostgresConnection, "socket_io", do_postgres_cConnection_socket_io, 0);
+  rb_define_method(cPostgresConnection, "flush", do_postgres_cConnection_flush, 0);
+  rb_define_method(cPostgresConnection, "consume_input", do_postgres_cConnection_consume_input, 0);
+  rb_define_method(cPostgresConnection, "busy?", do_postgres_cConnection_is_busy, 0);
+  rb_define_method(cPostgresConnection, "get_result", do_postgres_cConnection_get_result, 0);
+  rb_define_private_method(cPostgresConnection, "discard_pending", do_postgres_cConnection_discard_pending, 0);
+#endif
 
   cPostgresCommand = rb_define_class_under(mPostgres, "Command", cDO_Command);
   rb_define_method(cPostgresCommand, "set_types", data_objects_cCommand_set_types, -1);
   rb_define_method(cPostgresCommand, "execute_non_query", do_postgres_cCommand_execute_non_query, -1);
   rb_define_method(cPostgresCommand, "execute_reader", do_postgres_cCommand_execute_reader, -1);
+  rb_define_singleton_method(cPostgresCommand, "execute_readers", do_postgres_cCommand_s_execute_readers, -1);
+#ifndef _WIN32
+  rb_define_method(cPostgresCommand, "send_reader", do_postgres_cCommand_send_reader, -1);
+  rb_define_method(cPostgresCommand, "send_non_query", do_postgres_cCommand_send_non_query, -1);
+#endif
 
   cPostgresResult = rb_define_class_under(mPostgres, "Result", cDO_Result);
 
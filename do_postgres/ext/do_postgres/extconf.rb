@@ -31,10 +31,15 @@ dir_config('pgsql-server', config_value('includedir-server'), config_value('libd
 dir_config('pgsql-client', config_value('includedir'), config_value('libdir'))
 dir_config('pgsql-win32') if RUBY_PLATFORM =~ /mswin|mingw/
 
-desired_functions = %w(localtime_r gmtime_r PQsetClientEncoding pg_encoding_to_char PQfreemem)
+desired_functions = %w(localtime_r gmtime_r PQsetClientEncoding pg_encoding_to_char PQfreemem PQconnectStartParams
+                       poll rb_thread_call_without_gvl rb_thread_blocking_region rb_thread_check_ints
+                       rb_io_wait rb_wait_for_single_fd rb_fiber_scheduler_current)
 compat_functions = %w(PQescapeString PQexecParams)
 
 if have_build_env
+  have_header('ruby/thread.h')
+  have_header('ruby/io.h')
+  have_header('ruby/fiber/scheduler.h')
   desired_functions.each(&method(:have_func))
   $CFLAGS << ' -Wall ' unless RUBY_PLATFORM =~ /mswin/
   if RUBY_VERSION < '1.8.6'
@@ -6,4 +6,7 @@ require 'data_objects/spec/shared/command_spec'
 describe DataObjects::Postgres::Command do
   it_should_behave_like 'a Command'
   it_should_behave_like 'a Command with async'
+  it_should_behave_like 'a Command with execute_readers' unless JRUBY
+  it_should_behave_like 'a Command with a non-blocking API' unless JRUBY
+  it_should_behave_like 'a Command with query timeouts' unless JRUBY
 end
@@ -16,6 +16,7 @@ describe DataObjects::Postgres::Connection do
 
   it_should_behave_like 'a Connection'
   it_should_behave_like 'a Connection with authentication support'
+  it_should_behave_like 'a Connection with connect timeouts' unless JRUBY
   it_should_behave_like 'a Connection with JDBC URL support' if JRUBY
 
   describe 'byte array quoting' do
@@ -22,6 +22,7 @@ end
 require 'data_objects'
 require 'data_objects/spec/setup'
 require 'data_objects/spec/lib/pending_helpers'
+require 'data_objects/spec/lib/fiber_scheduler'
 require 'do_postgres'
 
 DataObjects::Postgres.logger = DataObjects::Logger.new(STDOUT, :off)
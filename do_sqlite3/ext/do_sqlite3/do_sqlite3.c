@@ -23,7 +23,110 @@ void do_sqlite3_raise_error(VALUE self, sqlite3 *result, VALUE query) {
   data_objects_raise_error(self, do_sqlite3_errors, errnum, message, query, sql_state);
 }
 
-VALUE do_sqlite3_typecast(sqlite3_stmt *stmt, int i, VALUE type, int encoding) {
+static int do_sqlite3_decltype_contains(const char *declared, const char *affinity) {
+  size_t length = strlen(affinity);
+
+  for (; *declared; declared++) {
+    if (sqlite3_strnicmp(declared, affinity, (int)length) == 0) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/*
+ * Maps the declared type of a column onto the Ruby type used to decode it,
+ * following SQLite's own affinity rules where they apply. Columns without a
+ * (recognized) declared type return nil and are decoded by storage class.
+ */
+VALUE do_sqlite3_infer_type(const char *declared) {
+  if (!declared) {
+    return Qnil;
+  }
+
+  if (do_sqlite3_decltype_contains(declared, "BOOL")) {
+    return rb_cTrueClass;
+  }
+  else if (do_sqlite3_decltype_contains(declared, "INT")) {
+    return rb_cInteger;
+  }
+  else if (do_sqlite3_decltype_contains(declared, "DATETIME") || do_sqlite3_decltype_contains(declared, "TIMESTAMP")) {
+    return rb_cDateTime;
+  }
+  else if (do_sqlite3_decltype_contains(declared, "DATE")) {
+    return rb_cDate;
+  }
+  else if (do_sqlite3_decltype_contains(declared, "DECIMAL") || do_sqlite3_decltype_contains(declared, "NUMERIC")) {
+    return rb_cBigDecimal;
+  }
+  else if (do_sqlite3_decltype_contains(declared, "REAL") || do_sqlite3_decltype_contains(declared, "FLOA") || do_sqlite3_decltype_contains(declared, "DOUB")) {
+    return rb_cFloat;
+  }
+  else if (do_sqlite3_decltype_contains(declared, "BLOB")) {
+    return rb_cByteArray;
+  }
+
+  return Qnil;
+}
+
+/*
+ * Builds the decoder plan for a prepared statement from the declared column
+ * types, so it only has to be computed once per statement.
+ */
+VALUE do_sqlite3_infer_types(sqlite3_stmt *stmt, int field_count) {
+  VALUE field_types = rb_ary_new2(field_count);
+  int i;
+
+  for (i = 0; i < field_count; i++) {
+    rb_ary_push(field_types, do_sqlite3_infer_type(sqlite3_column_decltype(stmt, i)));
+  }
+
+  return field_types;
+}
+
+/*
+ * Whether text starts with a date the parsers understand, YYYY-MM-DD.
+ */
+static int do_sqlite3_text_is_date(const char *text) {
+  int year, month, day;
+
+  return sscanf(text, "%4d-%2d-%2d", &year, &month, &day) == 3 && month >= 1 && month <= 12 && day >= 1 && day <= 31;
+}
+
+/*
+ * SQLite doesn't enforce declared types, so an inferred decoder is only used
+ * when the value is stored in a compatible storage class, and holds what the
+ * decoder expects. Anything else is decoded by storage class, as it was
+ * before the declared types were looked at.
+ */
+int do_sqlite3_value_matches(sqlite3_stmt *stmt, int i, VALUE type, int original_type) {
+  if (type == rb_cInteger) {
+    return original_type == SQLITE_INTEGER;
+  }
+  else if (type == rb_cFloat || type == rb_cBigDecimal) {
+    // NUMERIC affinity only keeps text that isn't a number
+    return original_type == SQLITE_FLOAT || original_type == SQLITE_INTEGER;
+  }
+  else if (type == rb_cTrueClass) {
+    if (original_type == SQLITE_TEXT) {
+      const char *text = (const char *)sqlite3_column_text(stmt, i);
+      return strcmp(text, "t") == 0 || strcmp(text, "f") == 0;
+    }
+
+    return original_type == SQLITE_INTEGER;
+  }
+  else if (type == rb_cDate || type == rb_cDateTime) {
+    return original_type == SQLITE_TEXT && do_sqlite3_text_is_date((const char *)sqlite3_column_text(stmt, i));
+  }
+  else if (type == rb_cByteArray) {
+    return original_type == SQLITE_BLOB;
+  }
+
+  return 1;
+}
+
+VALUE do_sqlite3_typecast(sqlite3_stmt *stmt, int i, VALUE type, int inferred, int encoding) {
   int original_type = sqlite3_column_type(stmt, i);
   int length = sqlite3_column_bytes(stmt, i);
 
@@ -37,6 +140,10 @@ VALUE do_sqlite3_typecast(sqlite3_stmt *stmt, int i, VALUE type, int encoding) {
   void *internal_encoding = NULL;
 #endif
 
+  if (inferred && type != Qnil && !do_sqlite3_value_matches(stmt, i, type, original_type)) {
+    type = Qnil;
+  }
+
   if (type == Qnil) {
     switch (original_type) {
       case SQLITE_INTEGER:
@@ -79,6 +186,10 @@ VALUE do_sqlite3_typecast(sqlite3_stmt *stmt, int i, VALUE type, int encoding) {
     return data_objects_parse_time((char*)sqlite3_column_text(stmt, i));
   }
   else if (type == rb_cTrueClass) {
+    if (original_type == SQLITE_INTEGER) {
+      return sqlite3_column_int64(stmt, i) != 0 ? Qtrue : Qfalse;
+    }
+
     return strcmp((char*)sqlite3_column_text(stmt, i), "t") == 0 ? Qtrue : Qfalse;
   }
   else if (type == rb_cByteArray) {
@@ -137,6 +248,293 @@ int do_sqlite3_flags_from_uri(VALUE uri) {
 
 #endif
 
+/*
+ * Backoff state for the busy handler, one per connection. The retry count
+ * sqlite3 passes in restarts at 0 for every new lock wait.
+ */
+typedef struct {
+  int timeout;
+  struct timeval start;
+  unsigned int seed;
+} do_sqlite3_busy_state;
+
+static void *do_sqlite3_busy_sleep(void *data) {
+  long delay = *(long *)data;
+
+#ifdef _WIN32
+  Sleep(delay);
+#else
+  struct timespec interval;
+
+  interval.tv_sec = delay / 1000;
+  interval.tv_nsec = (delay % 1000) * 1000000;
+  nanosleep(&interval, NULL);
+#endif
+
+  return NULL;
+}
+
+/*
+ * Waits for a lock with exponential backoff and jitter, so competing writers
+ * don't wake up in lockstep. The wait happens without holding the GVL, which
+ * leaves other Ruby threads free to run, and never raises, as sqlite3 is on
+ * the stack.
+ */
+static int do_sqlite3_busy_handler(void *data, int count) {
+  do_sqlite3_busy_state *state = (do_sqlite3_busy_state *)data;
+  struct timeval now;
+  long elapsed, delay;
+
+  if (count == 0) {
+    gettimeofday(&state->start, NULL);
+  }
+
+  gettimeofday(&now, NULL);
+  elapsed = (now.tv_sec - state->start.tv_sec) * 1000 + (now.tv_usec - state->start.tv_usec) / 1000;
+
+  if (elapsed >= state->timeout) {
+    return 0;
+  }
+
+  delay = 1L << (count < 7 ? count : 7);
+
+  // xorshift, good enough for spreading out retries
+  state->seed ^= state->seed << 13;
+  state->seed ^= state->seed >> 17;
+  state->seed ^= state->seed << 5;
+  delay = delay / 2 + state->seed % (delay / 2 + 1);
+
+  if (delay > state->timeout - elapsed) {
+    delay = state->timeout - elapsed;
+  }
+
+#if defined(HAVE_RB_THREAD_CALL_WITHOUT_GVL2)
+  rb_thread_call_without_gvl2(do_sqlite3_busy_sleep, &delay, NULL, NULL);
+#elif defined(HAVE_RB_THREAD_BLOCKING_REGION)
+  rb_thread_blocking_region((rb_blocking_function_t *)do_sqlite3_busy_sleep, &delay, NULL, NULL);
+#else
+  do_sqlite3_busy_sleep(&delay);
+#endif
+
+  return 1;
+}
+
+void do_sqlite3_setup_busy_handler(VALUE self, sqlite3 *db, int timeout) {
+  do_sqlite3_busy_state *state;
+  VALUE wrapper = Data_Make_Struct(rb_cObject, do_sqlite3_busy_state, 0, -1, state);
+
+  state->timeout = timeout;
+  state->seed = (unsigned int)time(NULL) ^ (unsigned int)(size_t)state;
+
+  if (state->seed == 0) {
+    state->seed = 1;
+  }
+
+  // Keep the state alive for as long as the connection is
+  rb_iv_set(self, "@busy_handler", wrapper);
+  sqlite3_busy_handler(db, do_sqlite3_busy_handler, state);
+}
+
+/*
+ * Interrupts the running statement once its deadline has passed, see
+ * Command#timeout. Statements run in the calling thread, so rather than
+ * calling sqlite3_interrupt from another one, the progress handler checks
+ * the deadline every so many instructions. The statement then fails with
+ * SQLITE_INTERRUPT, and the connection can be used again.
+ */
+static int do_sqlite3_progress_handler(void *data) {
+  struct timeval *deadline = (struct timeval *)data;
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return now.tv_sec > deadline->tv_sec || (now.tv_sec == deadline->tv_sec && now.tv_usec >= deadline->tv_usec);
+}
+
+void do_sqlite3_set_deadline(sqlite3 *db, struct timeval *deadline) {
+  if (deadline) {
+    sqlite3_progress_handler(db, 1000, do_sqlite3_progress_handler, deadline);
+  }
+  else {
+    sqlite3_progress_handler(db, 0, NULL, NULL);
+  }
+}
+
+// The time a Reader has left to step through its rows
+struct do_sqlite3_step_time {
+  double remaining;
+  struct timeval deadline;
+};
+
+// The deadline of the next step. Once the time is used up, the step is
+// interrupted at the first check.
+struct timeval *do_sqlite3_step_deadline(struct do_sqlite3_step_time *step_time) {
+  if (!data_objects_deadline(step_time->remaining, &step_time->deadline)) {
+    gettimeofday(&step_time->deadline, NULL);
+  }
+
+  return &step_time->deadline;
+}
+
+/*
+ * Only plain words or integers are accepted, as the values are interpolated
+ * into PRAGMA statements.
+ */
+const char *do_sqlite3_pragma_value(VALUE query_values, const char *key, int numeric) {
+  const char *value = data_objects_get_uri_option(query_values, key);
+  const char *c;
+
+  if (!value) {
+    return NULL;
+  }
+
+  for (c = value; *c; c++) {
+    if (numeric ? !(isdigit((unsigned char)*c) || (c == value && *c == '-')) : !isalnum((unsigned char)*c)) {
+      rb_raise(rb_eArgError, "Invalid value for %s: %s", key, value);
+    }
+  }
+
+  if (c == value) {
+    rb_raise(rb_eArgError, "Invalid value for %s: %s", key, value);
+  }
+
+  return value;
+}
+
+/*
+ * Applies the performance related URI options (journal_mode, synchronous,
+ * mmap_size, cache_size, temp_store and busy_timeout) in a single batch.
+ */
+void do_sqlite3_apply_uri_options(VALUE self, sqlite3 *db, VALUE uri) {
+  static const struct {
+    const char *name;
+    int numeric;
+  } pragmas[] = {
+    { "journal_mode", 0 },
+    { "synchronous", 0 },
+    { "mmap_size", 1 },
+    { "cache_size", 1 },
+    { "temp_store", 0 },
+    { NULL, 0 }
+  };
+
+  VALUE query_values = rb_funcall(uri, rb_intern("query"), 0);
+  VALUE batch = rb_str_new2("");
+  const char *busy_timeout = do_sqlite3_pragma_value(query_values, "busy_timeout", 1);
+  const char *value;
+  int i;
+
+  if (busy_timeout && atoi(busy_timeout) > 0) {
+    do_sqlite3_setup_busy_handler(self, db, atoi(busy_timeout));
+  }
+
+  for (i = 0; pragmas[i].name; i++) {
+    if ((value = do_sqlite3_pragma_value(query_values, pragmas[i].name, pragmas[i].numeric))) {
+      rb_str_cat2(batch, "PRAGMA ");
+      rb_str_cat2(batch, pragmas[i].name);
+      rb_str_cat2(batch, " = ");
+      rb_str_cat2(batch, value);
+      rb_str_cat2(batch, ";");
+    }
+  }
+
+  if (RSTRING_LEN(batch) > 0 && sqlite3_exec(db, RSTRING_PTR(batch), 0, 0, 0) != SQLITE_OK) {
+    do_sqlite3_raise_error(self, db, batch);
+  }
+}
+
+#ifdef HAVE_SQLITE3_STMT_STATUS
+static void do_sqlite3_add_counter(VALUE stats, const char *name, int count) {
+  VALUE key = ID2SYM(rb_intern(name));
+  VALUE total = rb_hash_aref(stats, key);
+
+  rb_hash_aset(stats, key, INT2NUM((total == Qnil ? 0 : NUM2INT(total)) + count));
+}
+#endif
+
+/*
+ * Adds the sqlite3_stmt_status counters of a statement to the given Hash,
+ * creating it when nil. Counters the linked SQLite doesn't know are left out.
+ */
+VALUE do_sqlite3_statement_stats(sqlite3_stmt *stmt, VALUE stats) {
+  if (stats == Qnil) {
+    stats = rb_hash_new();
+  }
+
+#ifdef HAVE_SQLITE3_STMT_STATUS
+  do_sqlite3_add_counter(stats, "fullscan_step", sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 0));
+  do_sqlite3_add_counter(stats, "sort", sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_SORT, 0));
+#ifdef SQLITE_STMTSTATUS_AUTOINDEX
+  do_sqlite3_add_counter(stats, "autoindex", sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_AUTOINDEX, 0));
+#endif
+#ifdef SQLITE_STMTSTATUS_VM_STEP
+  do_sqlite3_add_counter(stats, "vm_step", sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_VM_STEP, 0));
+#endif
+#ifdef SQLITE_STMTSTATUS_REPREPARE
+  do_sqlite3_add_counter(stats, "reprepare", sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_REPREPARE, 0));
+#endif
+#endif
+
+  return stats;
+}
+
+void do_sqlite3_record_statement_stats(VALUE sql, VALUE stats) {
+  rb_funcall(data_objects_const_get(mSqlite3, "StatementStats"), rb_intern("record"), 2, sql, stats);
+}
+
+/*
+ * Equivalent of sqlite3_exec that steps every statement itself, so the
+ * statement counters can be collected before the statements are finalized.
+ */
+int do_sqlite3_exec_with_stats(sqlite3 *db, const char *sql, VALUE *stats) {
+  const char *tail = sql;
+  sqlite3_stmt *stmt;
+  int status = SQLITE_OK;
+
+  while (*tail && status == SQLITE_OK) {
+    status = sqlite3_prepare_v2(db, tail, -1, &stmt, &tail);
+
+    if (status != SQLITE_OK) {
+      break;
+    }
+
+    // Only whitespace or a comment was left
+    if (!stmt) {
+      continue;
+    }
+
+    while ((status = sqlite3_step(stmt)) == SQLITE_ROW);
+
+    if (status == SQLITE_DONE) {
+      status = SQLITE_OK;
+    }
+
+    *stats = do_sqlite3_statement_stats(stmt, *stats);
+    sqlite3_finalize(stmt);
+  }
+
+  return status;
+}
+
+int do_sqlite3_statement_stats_enabled(VALUE uri) {
+  const char *value = data_objects_get_uri_option(rb_funcall(uri, rb_intern("query"), 0), "statement_stats");
+
+  return value && strcmp(value, "false") != 0 && strcmp(value, "0") != 0;
+}
+
+// The arguments of do_sqlite3_apply_uri_options, for rb_protect
+struct do_sqlite3_uri_options {
+  VALUE self;
+  sqlite3 *db;
+  VALUE uri;
+};
+
+static VALUE do_sqlite3_apply_uri_options_protected(VALUE data) {
+  struct do_sqlite3_uri_options *options = (struct do_sqlite3_uri_options *)data;
+
+  do_sqlite3_apply_uri_options(options->self, options->db, options->uri);
+  return Qnil;
+}
+
 /****** Public API ******/
 
 VALUE do_sqlite3_cConnection_initialize(VALUE self, VALUE uri) {
@@ -162,6 +560,23 @@ VALUE do_sqlite3_cConnection_initialize(VALUE self, VALUE uri) {
   rb_iv_set(self, "@encoding_id", INT2FIX(rb_enc_find_index("UTF-8")));
 #endif
 
+  struct do_sqlite3_uri_options options;
+  int state = 0;
+
+  options.self = self;
+  options.db = db;
+  options.uri = uri;
+
+  rb_protect(do_sqlite3_apply_uri_options_protected, (VALUE)&options, &state);
+
+  // Nothing closes the handle of a connection that failed to initialize
+  if (state) {
+    rb_iv_set(self, "@connection", Qnil);
+    sqlite3_close(db);
+    rb_jump_tag(state);
+  }
+
+  rb_iv_set(self, "@statement_stats", do_sqlite3_statement_stats_enabled(uri) ? Qtrue : Qfalse);
   return Qtrue;
 }
 
@@ -215,6 +630,187 @@ VALUE do_sqlite3_cConnection_quote_byte_array(VALUE self, VALUE string) {
   return rb_ary_join(array, Qnil);
 }
 
+struct do_sqlite3_bulk_insert {
+  VALUE self;
+  sqlite3 *db;
+  sqlite3_stmt *stmt;
+  VALUE sql;
+  VALUE rows;
+  long column_count;
+  long chunk_size;
+  int own_transaction;
+  do_int64 affected_rows;
+};
+
+/*
+ * Binds a value natively where SQLite has a matching type. Anything else is
+ * bound as the text it would be quoted as, so it's stored the same way as
+ * when it's passed as a query parameter.
+ */
+void do_sqlite3_bind_value(VALUE self, sqlite3_stmt *stmt, int index, VALUE value) {
+  if (value == Qnil) {
+    sqlite3_bind_null(stmt, index);
+  }
+  else if (rb_obj_is_kind_of(value, rb_cInteger) == Qtrue) {
+    sqlite3_bind_int64(stmt, index, NUM2LL(value));
+  }
+  else if (rb_obj_is_kind_of(value, rb_cFloat) == Qtrue) {
+    sqlite3_bind_double(stmt, index, NUM2DBL(value));
+  }
+  else if (rb_obj_is_kind_of(value, rb_cByteArray) == Qtrue) {
+    sqlite3_bind_blob(stmt, index, RSTRING_PTR(value), (int)RSTRING_LEN(value), SQLITE_TRANSIENT);
+  }
+  else if (TYPE(value) == T_STRING) {
+    sqlite3_bind_text(stmt, index, RSTRING_PTR(value), (int)RSTRING_LEN(value), SQLITE_TRANSIENT);
+  }
+  else {
+    VALUE quoted = rb_funcall(self, rb_intern("quote_value"), 1, value);
+    long length = RSTRING_LEN(quoted);
+
+    if (length >= 2 && RSTRING_PTR(quoted)[0] == '\'' && RSTRING_PTR(quoted)[length - 1] == '\'') {
+      quoted = rb_funcall(rb_str_new(RSTRING_PTR(quoted) + 1, length - 2), rb_intern("gsub"), 2, rb_str_new2("''"), rb_str_new2("'"));
+    }
+
+    sqlite3_bind_text(stmt, index, RSTRING_PTR(quoted), (int)RSTRING_LEN(quoted), SQLITE_TRANSIENT);
+  }
+}
+
+void do_sqlite3_bulk_exec(struct do_sqlite3_bulk_insert *insert, const char *sql) {
+  if (sqlite3_exec(insert->db, sql, 0, 0, 0) != SQLITE_OK) {
+    do_sqlite3_raise_error(insert->self, insert->db, rb_str_new2(sql));
+  }
+}
+
+VALUE do_sqlite3_bulk_insert_rows(VALUE data) {
+  struct do_sqlite3_bulk_insert *insert = (struct do_sqlite3_bulk_insert *)data;
+  long row_count = RARRAY_LEN(insert->rows);
+  long i, j;
+  VALUE row;
+
+  for (i = 0; i < row_count; i++) {
+    if (insert->own_transaction && i % insert->chunk_size == 0) {
+      do_sqlite3_bulk_exec(insert, "BEGIN IMMEDIATE");
+    }
+
+    row = rb_ary_entry(insert->rows, i);
+    Check_Type(row, T_ARRAY);
+
+    if (RARRAY_LEN(row) != insert->column_count) {
+      rb_raise(rb_eArgError, "Row %ld has %ld values, but %ld columns were given", i, RARRAY_LEN(row), insert->column_count);
+    }
+
+    for (j = 0; j < insert->column_count; j++) {
+      do_sqlite3_bind_value(insert->self, insert->stmt, (int)j + 1, rb_ary_entry(row, j));
+    }
+
+    if (sqlite3_step(insert->stmt) != SQLITE_DONE) {
+      do_sqlite3_raise_error(insert->self, insert->db, insert->sql);
+    }
+
+    insert->affected_rows += sqlite3_changes(insert->db);
+    sqlite3_reset(insert->stmt);
+
+    if (insert->own_transaction && ((i + 1) % insert->chunk_size == 0 || i + 1 == row_count)) {
+      do_sqlite3_bulk_exec(insert, "COMMIT");
+    }
+  }
+
+  return Qnil;
+}
+
+VALUE do_sqlite3_bulk_insert_cleanup(VALUE data) {
+  struct do_sqlite3_bulk_insert *insert = (struct do_sqlite3_bulk_insert *)data;
+
+  sqlite3_finalize(insert->stmt);
+
+  // Only set when a chunk was interrupted by an error
+  if (insert->own_transaction && !sqlite3_get_autocommit(insert->db)) {
+    sqlite3_exec(insert->db, "ROLLBACK", 0, 0, 0);
+  }
+
+  return Qnil;
+}
+
+/*
+ * call-seq:
+ *   bulk_insert(table, columns, rows, chunk_size = 1000) -> Result
+ *
+ * Inserts an Array of rows, each an Array of values for +columns+, reusing
+ * a single prepared INSERT statement. Unless a transaction is already open,
+ * every +chunk_size+ rows are inserted in their own transaction. If a row
+ * fails, its chunk is rolled back, but earlier chunks stay committed.
+ *
+ * Returns a Result with the total number of inserted rows and the row id of
+ * the last one.
+ */
+VALUE do_sqlite3_cConnection_bulk_insert(int argc, VALUE *argv, VALUE self) {
+  VALUE table, columns, rows, chunk_size;
+  VALUE sqlite3_connection = rb_iv_get(self, "@connection");
+  struct do_sqlite3_bulk_insert insert;
+  struct timeval start;
+  char *identifier;
+  long i;
+
+  rb_scan_args(argc, argv, "31", &table, &columns, &rows, &chunk_size);
+
+  if (sqlite3_connection == Qnil) {
+    rb_raise(eConnectionError, "This connection has already been closed.");
+  }
+
+  Check_Type(columns, T_ARRAY);
+  Check_Type(rows, T_ARRAY);
+
+  if (RARRAY_LEN(columns) == 0) {
+    rb_raise(rb_eArgError, "At least one column is required");
+  }
+
+  insert.self = self;
+  insert.rows = rows;
+  insert.column_count = RARRAY_LEN(columns);
+  insert.chunk_size = NIL_P(chunk_size) ? 1000 : NUM2LONG(chunk_size);
+  insert.affected_rows = 0;
+
+  if (insert.chunk_size < 1) {
+    rb_raise(rb_eArgError, "+chunk_size+ should be positive, but was %ld", insert.chunk_size);
+  }
+
+  Data_Get_Struct(sqlite3_connection, sqlite3, insert.db);
+
+  insert.sql = rb_str_new2("INSERT INTO ");
+  identifier = sqlite3_mprintf("\"%w\" (", StringValueCStr(table));
+  rb_str_cat2(insert.sql, identifier);
+  sqlite3_free(identifier);
+
+  for (i = 0; i < insert.column_count; i++) {
+    VALUE column = rb_obj_as_string(rb_ary_entry(columns, i));
+
+    identifier = sqlite3_mprintf(i == 0 ? "\"%w\"" : ", \"%w\"", StringValueCStr(column));
+    rb_str_cat2(insert.sql, identifier);
+    sqlite3_free(identifier);
+  }
+
+  rb_str_cat2(insert.sql, ") VALUES (");
+
+  for (i = 0; i < insert.column_count; i++) {
+    rb_str_cat2(insert.sql, i == 0 ? "?" : ", ?");
+  }
+
+  rb_str_cat2(insert.sql, ")");
+
+  gettimeofday(&start, NULL);
+
+  if (sqlite3_prepare_v2(insert.db, RSTRING_PTR(insert.sql), -1, &insert.stmt, 0) != SQLITE_OK) {
+    do_sqlite3_raise_error(self, insert.db, insert.sql);
+  }
+
+  insert.own_transaction = sqlite3_get_autocommit(insert.db);
+  rb_ensure(do_sqlite3_bulk_insert_rows, (VALUE)&insert, do_sqlite3_bulk_insert_cleanup, (VALUE)&insert);
+
+  data_objects_debug(self, insert.sql, &start);
+
+  return rb_funcall(cSqlite3Result, ID_NEW, 3, Qnil, LL2NUM(insert.affected_rows), LL2NUM(sqlite3_last_insert_rowid(insert.db)));
+}
+
 VALUE do_sqlite3_cCommand_execute_non_query(int argc, VALUE *argv, VALUE self) {
   VALUE query = data_objects_build_query_from_args(self, argc, argv);
   VALUE connection = rb_iv_get(self, "@connection");
@@ -228,18 +824,46 @@ VALUE do_sqlite3_cCommand_execute_non_query(int argc, VALUE *argv, VALUE self) {
 
   Data_Get_Struct(sqlite3_connection, sqlite3, db);
 
-  struct timeval start;
-  char *error_message;
+  struct timeval start, deadline;
+  char *error_message = NULL;
   int status;
+  VALUE stats = Qnil;
+  double timeout = data_objects_query_timeout(self);
+  struct timeval *until = data_objects_deadline(timeout, &deadline);
 
   gettimeofday(&start, NULL);
-  status = sqlite3_exec(db, rb_str_ptr_readonly(query), 0, 0, &error_message);
+
+  if (until) {
+    do_sqlite3_set_deadline(db, until);
+  }
+
+  if (rb_iv_get(connection, "@statement_stats") == Qtrue) {
+    status = do_sqlite3_exec_with_stats(db, rb_str_ptr_readonly(query), &stats);
+  }
+  else {
+    status = sqlite3_exec(db, rb_str_ptr_readonly(query), 0, 0, &error_message);
+  }
+
+  // The errors are raised from sqlite3_errmsg
+  sqlite3_free(error_message);
+
+  if (until) {
+    do_sqlite3_set_deadline(db, NULL);
+
+    if (status == SQLITE_INTERRUPT) {
+      data_objects_raise_query_timeout(self, timeout, query);
+    }
+  }
 
   if (status != SQLITE_OK) {
     do_sqlite3_raise_error(self, db, query);
   }
 
-  data_objects_debug(connection, query, &start);
+  data_objects_debug_with_stats(connection, query, &start, stats);
+
+  if (stats != Qnil) {
+    do_sqlite3_record_statement_stats(rb_iv_get(self, "@text"), stats);
+  }
 
   int affected_rows = sqlite3_changes(db);
   do_int64 insert_id = sqlite3_last_insert_rowid(db);
@@ -263,10 +887,16 @@ VALUE do_sqlite3_cCommand_execute_reader(int argc, VALUE *argv, VALUE self) {
   sqlite3_stmt *sqlite3_reader;
   struct timeval start;
   int status;
+  int statement_stats = rb_iv_get(connection, "@statement_stats") == Qtrue;
 
   gettimeofday(&start, NULL);
   status = sqlite3_prepare_v2(db, rb_str_ptr_readonly(query), -1, &sqlite3_reader, 0);
-  data_objects_debug(connection, query, &start);
+
+  // With statement stats the query is logged when the reader is closed,
+  // as the counters are only known once the rows have been stepped through.
+  if (!statement_stats || status != SQLITE_OK) {
+    data_objects_debug(connection, query, &start);
+  }
 
   if (status != SQLITE_OK) {
     do_sqlite3_raise_error(self, db, query);
@@ -279,10 +909,34 @@ VALUE do_sqlite3_cCommand_execute_reader(int argc, VALUE *argv, VALUE self) {
   rb_iv_set(reader, "@field_count", INT2NUM(field_count));
   rb_iv_set(reader, "@connection", connection);
 
+  // The rows are stepped through by the reader, which keeps the time left
+  double timeout = data_objects_query_timeout(self);
+
+  if (timeout > 0) {
+    struct do_sqlite3_step_time *step_time;
+
+    rb_iv_set(reader, "@step_time", Data_Make_Struct(rb_cObject, struct do_sqlite3_step_time, 0, -1, step_time));
+    step_time->remaining = timeout;
+    rb_iv_set(reader, "@timeout", rb_float_new(timeout));
+    rb_iv_set(reader, "@query", query);
+  }
+
+  if (statement_stats) {
+    struct timeval *started_at;
+
+    rb_iv_set(reader, "@started_at", Data_Make_Struct(rb_cObject, struct timeval, 0, -1, started_at));
+    *started_at = start;
+    rb_iv_set(reader, "@query", query);
+    rb_iv_set(reader, "@sql", rb_iv_get(self, "@text"));
+    rb_funcall(data_objects_const_get(mSqlite3, "StatementStats"), rb_intern("track"), 3, reader, rb_iv_get(reader, "@reader"), rb_iv_get(self, "@text"));
+  }
+
   VALUE field_types = rb_iv_get(self, "@field_types");
+  VALUE field_types_inferred = Qfalse;
 
   if (field_types == Qnil || RARRAY_LEN(field_types) == 0) {
-    field_types = rb_ary_new();
+    field_types = do_sqlite3_infer_types(sqlite3_reader, field_count);
+    field_types_inferred = Qtrue;
   }
   else if (RARRAY_LEN(field_types) != field_count) {
     // Whoops...  wrong number of types passed to set_types.  Close the reader and raise
@@ -300,17 +954,30 @@ VALUE do_sqlite3_cCommand_execute_reader(int argc, VALUE *argv, VALUE self) {
 
   rb_iv_set(reader, "@fields", field_names);
   rb_iv_set(reader, "@field_types", field_types);
+  rb_iv_set(reader, "@field_types_inferred", field_types_inferred);
   return reader;
 }
 
 VALUE do_sqlite3_cReader_close(VALUE self) {
   VALUE reader_obj = rb_iv_get(self, "@reader");
 
-  if (reader_obj != Qnil) {
+  // Without a statement, StatementStats.track already finalized it
+  if (reader_obj != Qnil && DATA_PTR(reader_obj)) {
     sqlite3_stmt *reader = NULL;
 
     Data_Get_Struct(reader_obj, sqlite3_stmt, reader);
+
+    if (rb_iv_get(self, "@sql") != Qnil) {
+      struct timeval *started_at;
+      VALUE stats = do_sqlite3_statement_stats(reader, Qnil);
+
+      Data_Get_Struct(rb_iv_get(self, "@started_at"), struct timeval, started_at);
+      data_objects_debug_with_stats(rb_iv_get(self, "@connection"), rb_iv_get(self, "@query"), started_at, stats);
+      do_sqlite3_record_statement_stats(rb_iv_get(self, "@sql"), stats);
+    }
+
     sqlite3_finalize(reader);
+    DATA_PTR(reader_obj) = NULL;
     rb_iv_set(self, "@reader", Qnil);
     return Qtrue;
   }
@@ -318,6 +985,22 @@ VALUE do_sqlite3_cReader_close(VALUE self) {
   return Qfalse;
 }
 
+/*
+ * Records the counters of the statement of a reader that was garbage
+ * collected without being closed, see StatementStats.track.
+ */
+VALUE do_sqlite3_cReader_finalize_statement(VALUE klass, VALUE reader_obj, VALUE sql) {
+  sqlite3_stmt *reader = DATA_PTR(reader_obj);
+
+  if (reader) {
+    do_sqlite3_record_statement_stats(sql, do_sqlite3_statement_stats(reader, Qnil));
+    sqlite3_finalize(reader);
+    DATA_PTR(reader_obj) = NULL;
+  }
+
+  return Qnil;
+}
+
 VALUE do_sqlite3_cReader_next(VALUE self) {
 
   VALUE reader = rb_iv_get(self, "@reader");
@@ -335,7 +1018,32 @@ VALUE do_sqlite3_cReader_next(VALUE self) {
 
   Data_Get_Struct(reader, sqlite3_stmt, sqlite_reader);
 
+  // Only the time spent stepping counts against the timeout, not the time
+  // the application takes between rows
+  VALUE step_time_obj = rb_iv_get(self, "@step_time");
+  struct do_sqlite3_step_time *step_time = NULL;
+  struct timeval start, stop;
+
+  if (step_time_obj != Qnil) {
+    Data_Get_Struct(step_time_obj, struct do_sqlite3_step_time, step_time);
+    gettimeofday(&start, NULL);
+    do_sqlite3_set_deadline(sqlite3_db_handle(sqlite_reader), do_sqlite3_step_deadline(step_time));
+  }
+
   result = sqlite3_step(sqlite_reader);
+
+  if (step_time) {
+    do_sqlite3_set_deadline(sqlite3_db_handle(sqlite_reader), NULL);
+
+    if (result == SQLITE_INTERRUPT) {
+      rb_funcall(self, rb_intern("close"), 0);
+      data_objects_raise_query_timeout(self, NUM2DBL(rb_iv_get(self, "@timeout")), rb_iv_get(self, "@query"));
+    }
+
+    gettimeofday(&stop, NULL);
+    step_time->remaining -= (stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0;
+  }
+
   rb_iv_set(self, "@state", INT2NUM(result));
 
   if (result != SQLITE_ROW) {
@@ -354,6 +1062,7 @@ VALUE do_sqlite3_cReader_next(VALUE self) {
 #endif
 
   VALUE field_types = rb_iv_get(self, "@field_types");
+  int inferred = rb_iv_get(self, "@field_types_inferred") == Qtrue;
   int field_count = NUM2INT(rb_iv_get(self, "@field_count"));
   VALUE arr = rb_ary_new();
   VALUE field_type;
@@ -362,7 +1071,7 @@ VALUE do_sqlite3_cReader_next(VALUE self) {
 
   for (i = 0; i < field_count; i++) {
     field_type = rb_ary_entry(field_types, i);
-    value = do_sqlite3_typecast(sqlite_reader, i, field_type, enc);
+    value = do_sqlite3_typecast(sqlite_reader, i, field_type, inferred, enc);
     rb_ary_push(arr, value);
   }
 
@@ -393,6 +1102,7 @@ void Init_do_sqlite3() {
   rb_define_method(cSqlite3Connection, "quote_string", do_sqlite3_cConnection_quote_string, 1);
   rb_define_method(cSqlite3Connection, "quote_byte_array", do_sqlite3_cConnection_quote_byte_array, 1);
   rb_define_method(cSqlite3Connection, "character_set", data_objects_cConnection_character_set, 0);
+  rb_define_method(cSqlite3Connection, "bulk_insert", do_sqlite3_cConnection_bulk_insert, -1);
 
   cSqlite3Command = rb_define_class_under(mSqlite3, "Command", cDO_Command);
   rb_define_method(cSqlite3Command, "set_types", data_objects_cCommand_set_types, -1);
@@ -403,6 +1113,7 @@ void Init_do_sqlite3() {
 
   cSqlite3Reader = rb_define_class_under(mSqlite3, "Reader", cDO_Reader);
   rb_define_method(cSqlite3Reader, "close", do_sqlite3_cReader_close, 0);
+  rb_define_private_method(rb_singleton_class(cSqlite3Reader), "finalize_statement", do_sqlite3_cReader_finalize_statement, 2);
   rb_define_method(cSqlite3Reader, "next!", do_sqlite3_cReader_next, 0);
   rb_define_method(cSqlite3Reader, "values", do_sqlite3_cReader_values, 0); // TODO: DRY?
   rb_define_method(cSqlite3Reader, "fields", data_objects_cReader_fields, 0);
@@ -6,13 +6,23 @@
 #include <math.h>
 #include <time.h>
 #include <locale.h>
+#include <ctype.h>
 #include <sqlite3.h>
 #include "compat.h"
 
+#ifdef HAVE_RUBY_THREAD_H
+#include <ruby/thread.h>
+#endif
+
 #ifndef HAVE_SQLITE3_PREPARE_V2
 #define sqlite3_prepare_v2 sqlite3_prepare
 #endif
 
+#ifndef HAVE_RB_ERRINFO
+#define rb_errinfo() ruby_errinfo
+#define rb_set_errinfo(err) (ruby_errinfo = (err))
+#endif
+
 extern VALUE mSqlite3;
 extern void Init_do_sqlite3_extension();
 
@@ -78,8 +78,346 @@ VALUE do_sqlite3_cExtension_load_extension(VALUE self, VALUE path) {
 #endif
 }
 
+/*
+ * Returns the sqlite3 handle of the connection this extension was created
+ * for, raising when the connection has already been closed.
+ */
+static sqlite3 *do_sqlite3_extension_db(VALUE self) {
+  VALUE connection = rb_iv_get(self, "@connection");
+  VALUE sqlite3_connection;
+  sqlite3 *db = NULL;
+
+  if (connection == Qnil) {
+    rb_raise(eConnectionError, "This extension has no connection.");
+  }
+
+  sqlite3_connection = rb_iv_get(connection, "@connection");
+
+  if (sqlite3_connection == Qnil || !(db = DATA_PTR(sqlite3_connection))) {
+    rb_raise(eConnectionError, "This connection has already been closed.");
+  }
+
+  return db;
+}
+
+/*
+ * Keeps the Ruby callables used by SQL functions reachable for as long as the
+ * connection lives, as sqlite3 only holds on to them as raw pointers.
+ */
+static void do_sqlite3_extension_retain(VALUE self, VALUE name, int arity, VALUE callable) {
+  VALUE connection = rb_iv_get(self, "@connection");
+  VALUE functions = rb_iv_get(connection, "@functions");
+
+  if (functions == Qnil) {
+    functions = rb_hash_new();
+    rb_iv_set(connection, "@functions", functions);
+  }
+
+  rb_hash_aset(functions, rb_ary_new3(2, name, INT2NUM(arity)), callable);
+}
+
+static void *do_sqlite3_native_pointer(VALUE address) {
+  return (void *)(size_t)NUM2ULL(rb_funcall(address, rb_intern("to_i"), 0));
+}
+
+static VALUE do_sqlite3_option(VALUE options, const char *key) {
+  if (options == Qnil) {
+    return Qnil;
+  }
+
+  Check_Type(options, T_HASH);
+  return rb_hash_aref(options, ID2SYM(rb_intern(key)));
+}
+
+static int do_sqlite3_function_flags(VALUE options) {
+  int flags = SQLITE_UTF8;
+
+#ifdef SQLITE_DETERMINISTIC
+  if (RTEST(do_sqlite3_option(options, "deterministic"))) {
+    flags |= SQLITE_DETERMINISTIC;
+  }
+#endif
+
+  return flags;
+}
+
+static VALUE do_sqlite3_value_to_ruby(sqlite3_value *value) {
+  int length = sqlite3_value_bytes(value);
+
+  switch (sqlite3_value_type(value)) {
+    case SQLITE_INTEGER:
+      return LL2NUM(sqlite3_value_int64(value));
+
+    case SQLITE_FLOAT:
+      return rb_float_new(sqlite3_value_double(value));
+
+    case SQLITE_BLOB:
+      return rb_funcall(rb_cByteArray, ID_NEW, 1, rb_str_new((const char *)sqlite3_value_blob(value), length));
+
+    case SQLITE_NULL:
+      return Qnil;
+
+    default: {
+      VALUE string = rb_str_new((const char *)sqlite3_value_text(value), length);
+#ifdef HAVE_RUBY_ENCODING_H
+      rb_enc_associate_index(string, rb_enc_find_index("UTF-8"));
+#endif
+      return string;
+    }
+  }
+}
+
+static void do_sqlite3_set_result(sqlite3_context *context, VALUE result) {
+  if (result == Qnil) {
+    sqlite3_result_null(context);
+  }
+  else if (result == Qtrue || result == Qfalse) {
+    // Same representation as DataObjects uses for quoting booleans
+    sqlite3_result_text(context, result == Qtrue ? "t" : "f", 1, SQLITE_STATIC);
+  }
+  else if (rb_obj_is_kind_of(result, rb_cInteger) == Qtrue) {
+    sqlite3_result_int64(context, NUM2LL(result));
+  }
+  else if (rb_obj_is_kind_of(result, rb_cFloat) == Qtrue) {
+    sqlite3_result_double(context, NUM2DBL(result));
+  }
+  else if (rb_obj_is_kind_of(result, rb_cByteArray) == Qtrue) {
+    sqlite3_result_blob(context, RSTRING_PTR(result), (int)RSTRING_LEN(result), SQLITE_TRANSIENT);
+  }
+  else {
+    VALUE string = rb_obj_as_string(result);
+    sqlite3_result_text(context, RSTRING_PTR(string), (int)RSTRING_LEN(string), SQLITE_TRANSIENT);
+  }
+}
+
+struct do_sqlite3_call {
+  VALUE receiver;
+  ID method;
+  int argc;
+  sqlite3_value **argv;
+};
+
+static VALUE do_sqlite3_call_ruby(VALUE arg) {
+  struct do_sqlite3_call *call = (struct do_sqlite3_call *)arg;
+  VALUE args = rb_ary_new2(call->argc);
+  int i;
+
+  for (i = 0; i < call->argc; i++) {
+    rb_ary_push(args, do_sqlite3_value_to_ruby(call->argv[i]));
+  }
+
+  return rb_funcall2(call->receiver, call->method, (int)RARRAY_LEN(args), RARRAY_PTR(args));
+}
+
+/*
+ * Calls into Ruby from inside sqlite3. Exceptions must never unwind through
+ * the sqlite3 stack, so they're turned into a SQL error for the statement,
+ * which surfaces as a DataObjects::SQLError from the executing command.
+ */
+static int do_sqlite3_protected_call(sqlite3_context *context, VALUE receiver, ID method, int argc, sqlite3_value **argv, VALUE *result) {
+  struct do_sqlite3_call call;
+  int state = 0;
+
+  call.receiver = receiver;
+  call.method = method;
+  call.argc = argc;
+  call.argv = argv;
+
+  *result = rb_protect(do_sqlite3_call_ruby, (VALUE)&call, &state);
+
+  if (state) {
+    VALUE message = rb_obj_as_string(rb_errinfo());
+
+    rb_set_errinfo(Qnil);
+    sqlite3_result_error(context, RSTRING_PTR(message), (int)RSTRING_LEN(message));
+    return 0;
+  }
+
+  return 1;
+}
+
+static void do_sqlite3_function_callback(sqlite3_context *context, int argc, sqlite3_value **argv) {
+  VALUE result;
+
+  if (do_sqlite3_protected_call(context, (VALUE)sqlite3_user_data(context), rb_intern("call"), argc, argv, &result)) {
+    do_sqlite3_set_result(context, result);
+  }
+}
+
+/*
+ * Ruby aggregates get a fresh handler instance per group, stored in the
+ * aggregate context and registered with the GC until the group finalizes.
+ */
+static VALUE *do_sqlite3_aggregate_instance(sqlite3_context *context) {
+  VALUE *instance = sqlite3_aggregate_context(context, sizeof(VALUE));
+
+  if (!instance) {
+    return NULL;
+  }
+
+  if (*instance == 0) {
+    *instance = Qnil;
+    rb_gc_register_address(instance);
+  }
+
+  return instance;
+}
+
+static VALUE do_sqlite3_aggregate_new(VALUE handler) {
+  return rb_funcall(handler, ID_NEW, 0);
+}
+
+static int do_sqlite3_aggregate_prepare(sqlite3_context *context, VALUE *instance) {
+  int state = 0;
+
+  if (*instance != Qnil) {
+    return 1;
+  }
+
+  *instance = rb_protect(do_sqlite3_aggregate_new, (VALUE)sqlite3_user_data(context), &state);
+
+  if (state) {
+    VALUE message = rb_obj_as_string(rb_errinfo());
+
+    rb_set_errinfo(Qnil);
+    *instance = Qnil;
+    sqlite3_result_error(context, RSTRING_PTR(message), (int)RSTRING_LEN(message));
+    return 0;
+  }
+
+  return 1;
+}
+
+static void do_sqlite3_aggregate_step(sqlite3_context *context, int argc, sqlite3_value **argv) {
+  VALUE *instance = do_sqlite3_aggregate_instance(context);
+  VALUE result;
+
+  if (!instance) {
+    sqlite3_result_error_nomem(context);
+    return;
+  }
+
+  if (do_sqlite3_aggregate_prepare(context, instance)) {
+    do_sqlite3_protected_call(context, *instance, rb_intern("step"), argc, argv, &result);
+  }
+}
+
+static void do_sqlite3_aggregate_final(sqlite3_context *context) {
+  VALUE *instance = do_sqlite3_aggregate_instance(context);
+  VALUE result;
+
+  if (!instance) {
+    sqlite3_result_error_nomem(context);
+    return;
+  }
+
+  if (do_sqlite3_aggregate_prepare(context, instance) &&
+      do_sqlite3_protected_call(context, *instance, rb_intern("finalize"), 0, NULL, &result)) {
+    do_sqlite3_set_result(context, result);
+  }
+
+  rb_gc_unregister_address(instance);
+  *instance = Qnil;
+}
+
+static void do_sqlite3_check_function_status(sqlite3 *db, int status) {
+  if (status != SQLITE_OK) {
+    rb_raise(eConnectionError, "Couldn't create function: %s", sqlite3_errmsg(db));
+  }
+}
+
+#ifdef HAVE_SQLITE3_CREATE_FUNCTION_V2
+#define do_sqlite3_create_function(db, name, arity, flags, data, func, step, final) \
+  sqlite3_create_function_v2(db, name, arity, flags, data, func, step, final, NULL)
+#else
+#define do_sqlite3_create_function(db, name, arity, flags, data, func, step, final) \
+  sqlite3_create_function(db, name, arity, flags, data, func, step, final)
+#endif
+
+/*
+ * call-seq:
+ *   create_function(name, arity, options = {}) { |*args| ... }
+ *   create_function(name, arity, :native => address)
+ *
+ * Registers a scalar SQL function on the connection. The function is either
+ * the given block, or a C function (void (*)(sqlite3_context *, int,
+ * sqlite3_value **)) at the address given as the :native option, for example
+ * from a Fiddle::Pointer. An arity of -1 accepts any number of arguments.
+ * Pass :deterministic => true to let SQLite optimize repeated calls.
+ */
+VALUE do_sqlite3_cExtension_create_function(int argc, VALUE *argv, VALUE self) {
+  VALUE name, arity, options, block, native;
+  sqlite3 *db = do_sqlite3_extension_db(self);
+  int status;
+
+  rb_scan_args(argc, argv, "21&", &name, &arity, &options, &block);
+  native = do_sqlite3_option(options, "native");
+
+  if (native != Qnil) {
+    status = do_sqlite3_create_function(db, StringValueCStr(name), NUM2INT(arity), do_sqlite3_function_flags(options), NULL,
+                                        (void (*)(sqlite3_context *, int, sqlite3_value **))do_sqlite3_native_pointer(native), NULL, NULL);
+  }
+  else if (block != Qnil) {
+    do_sqlite3_extension_retain(self, name, NUM2INT(arity), block);
+    status = do_sqlite3_create_function(db, StringValueCStr(name), NUM2INT(arity), do_sqlite3_function_flags(options), (void *)block,
+                                        do_sqlite3_function_callback, NULL, NULL);
+  }
+  else {
+    rb_raise(rb_eArgError, "Either a block or the :native option is required");
+  }
+
+  do_sqlite3_check_function_status(db, status);
+  return Qtrue;
+}
+
+/*
+ * call-seq:
+ *   create_aggregate(name, arity, handler, options = {})
+ *   create_aggregate(name, arity, :step => address, :final => address)
+ *
+ * Registers an aggregate SQL function on the connection. A Ruby handler is a
+ * class whose instances respond to #step(*args) and #finalize; one instance is
+ * created for every group. Native aggregates take the addresses of the C step
+ * and final functions. Accepts :deterministic like #create_function.
+ */
+VALUE do_sqlite3_cExtension_create_aggregate(int argc, VALUE *argv, VALUE self) {
+  VALUE name, arity, handler, options;
+  sqlite3 *db = do_sqlite3_extension_db(self);
+  int status;
+
+  rb_scan_args(argc, argv, "22", &name, &arity, &handler, &options);
+
+  if (TYPE(handler) == T_HASH && options == Qnil) {
+    options = handler;
+    handler = Qnil;
+  }
+
+  if (handler != Qnil) {
+    do_sqlite3_extension_retain(self, name, NUM2INT(arity), handler);
+    status = do_sqlite3_create_function(db, StringValueCStr(name), NUM2INT(arity), do_sqlite3_function_flags(options), (void *)handler,
+                                        NULL, do_sqlite3_aggregate_step, do_sqlite3_aggregate_final);
+  }
+  else {
+    VALUE step = do_sqlite3_option(options, "step");
+    VALUE final = do_sqlite3_option(options, "final");
+
+    if (step == Qnil || final == Qnil) {
+      rb_raise(rb_eArgError, "Either a handler or both the :step and :final options are required");
+    }
+
+    status = do_sqlite3_create_function(db, StringValueCStr(name), NUM2INT(arity), do_sqlite3_function_flags(options), NULL, NULL,
+                                        (void (*)(sqlite3_context *, int, sqlite3_value **))do_sqlite3_native_pointer(step),
+                                        (void (*)(sqlite3_context *))do_sqlite3_native_pointer(final));
+  }
+
+  do_sqlite3_check_function_status(db, status);
+  return Qtrue;
+}
+
 void Init_do_sqlite3_extension() {
   cSqlite3Extension = rb_define_class_under(mSqlite3, "Extension", cDO_Extension);
   rb_define_method(cSqlite3Extension, "load_extension", do_sqlite3_cExtension_load_extension, 1);
   rb_define_method(cSqlite3Extension, "enable_load_extension", do_sqlite3_cExtension_enable_load_extension, 1);
+  rb_define_method(cSqlite3Extension, "create_function", do_sqlite3_cExtension_create_function, -1);
+  rb_define_method(cSqlite3Extension, "create_aggregate", do_sqlite3_cExtension_create_aggregate, -1);
 }
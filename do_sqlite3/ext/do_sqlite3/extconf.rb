@@ -26,9 +26,16 @@ end
 if have_header( "sqlite3.h" ) && have_library( "sqlite3", "sqlite3_open" )
   have_func("localtime_r")
   have_func("gmtime_r")
+  have_func("rb_errinfo")
+  have_header("ruby/thread.h") && have_func("rb_thread_call_without_gvl2", "ruby/thread.h")
+  have_func("rb_thread_blocking_region")
+  have_header("ruby/io.h") && have_func("rb_io_wait", "ruby/io.h")
+  have_func("rb_wait_for_single_fd", "ruby/io.h")
   have_func("sqlite3_prepare_v2")
   have_func("sqlite3_open_v2")
   have_func("sqlite3_enable_load_extension")
+  have_func("sqlite3_create_function_v2")
+  have_func("sqlite3_stmt_status")
 
   create_makefile('do_sqlite3/do_sqlite3')
 end
@@ -36,6 +36,7 @@ end
 
 require 'do_sqlite3/version'
 require 'do_sqlite3/transaction' if RUBY_PLATFORM !~ /java/
+require 'do_sqlite3/statement_stats' if RUBY_PLATFORM !~ /java/
 
 if RUBY_PLATFORM =~ /java/
 
@@ -0,0 +1,82 @@
+require 'thread'
+
+module DataObjects
+
+  module Sqlite3
+
+    # Aggregates the sqlite3_stmt_status counters of every query run on a
+    # connection opened with the +statement_stats+ URI option, keyed by the
+    # SQL text of the command (before parameters are bound):
+    #
+    #   DataObjects::Connection.new("sqlite3:/var/db/app.db?statement_stats=true")
+    #   ...
+    #   DataObjects::Sqlite3::StatementStats["SELECT * FROM users WHERE name = ?"]
+    #   # => { :executions => 12, :fullscan_step => 1188, :sort => 0, ... }
+    #
+    # A non zero +fullscan_step+, +sort+ or +autoindex+ count usually points
+    # at a missing index.
+    #
+    # Only the MAX_STATEMENTS most recently run SQL texts are kept, as an
+    # application that puts values into the SQL itself has no end of them.
+    # A reader that's never closed is counted when it's garbage collected.
+    module StatementStats
+
+      MAX_STATEMENTS = 1000
+
+      @lock  = Mutex.new
+      @stats = {}
+
+      # Add the counters of a single execution of +sql+. Called by the driver.
+      def self.record(sql, counters)
+        @lock.synchronize do
+          # Moved to the end, so the least recently run SQL goes first
+          totals = @stats.delete(sql) || Hash.new(0)
+          @stats[sql] = totals
+          @stats.shift if @stats.size > MAX_STATEMENTS
+
+          totals[:executions] += 1
+          counters.each { |name, count| totals[name] += count }
+        end
+        nil
+      end
+
+      # Records the counters of the statement of a reader once the reader is
+      # garbage collected, unless it was closed. Called by the driver.
+      def self.track(reader, statement, sql)
+        ObjectSpace.define_finalizer(reader, finalizer(statement, sql))
+        nil
+      end
+
+      # Kept apart from track, so the proc doesn't hold on to the reader
+      def self.finalizer(statement, sql)
+        proc { Reader.__send__(:finalize_statement, statement, sql) }
+      end
+      private_class_method :finalizer
+
+      # The aggregated counters for +sql+, or nil when it hasn't been run
+      def self.[](sql)
+        @lock.synchronize do
+          totals = @stats[sql]
+          totals && Hash[totals]
+        end
+      end
+
+      # A snapshot of the aggregated counters of all queries
+      def self.to_hash
+        @lock.synchronize do
+          result = {}
+          @stats.each { |sql, totals| result[sql] = Hash[totals] }
+          result
+        end
+      end
+
+      def self.reset!
+        @lock.synchronize { @stats.clear }
+        nil
+      end
+
+    end
+
+  end
+
+end
@@ -5,4 +5,38 @@ require 'data_objects/spec/shared/command_spec'
 
 describe DataObjects::Sqlite3::Command do
   it_should_behave_like 'a Command'
+  it_should_behave_like 'a Command with query timeouts' unless JRUBY
+
+  unless JRUBY
+    describe 'with a timeout' do
+
+      before :all do
+        setup_test_environment
+      end
+
+      before do
+        @connection = DataObjects::Connection.new(CONFIG.uri)
+      end
+
+      after do
+        @connection.close
+      end
+
+      it 'should only count the time spent stepping through the rows' do
+        # Each row takes a while to step to
+        command = @connection.create_command(<<-SQL)
+          WITH RECURSIVE counter(n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM counter WHERE n < 100000)
+          SELECT count(*) FROM counter UNION ALL SELECT count(*) FROM counter
+        SQL
+        command.timeout = 0.2
+        reader = command.execute_reader
+        reader.next!.should be_true
+        sleep 0.3
+        reader.next!.should be_true
+        reader.values.should == [100000]
+        reader.close
+      end
+
+    end
+  end
 end
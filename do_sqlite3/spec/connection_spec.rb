@@ -2,6 +2,7 @@
 
 require File.expand_path(File.join(File.dirname(__FILE__), 'spec_helper'))
 require 'data_objects/spec/shared/connection_spec'
+require 'tmpdir'
 
 describe DataObjects::Sqlite3::Connection do
 
@@ -17,4 +18,130 @@ describe DataObjects::Sqlite3::Connection do
   it_should_behave_like 'a Connection'
   it_should_behave_like 'a Connection via JDNI' if JRUBY
   it_should_behave_like 'a Connection with JDBC URL support' if JRUBY
+
+  describe 'performance options' do
+
+    def pragma(connection, name)
+      reader = connection.create_command("PRAGMA #{name}").execute_reader
+      reader.next!
+      value = reader.values.first
+      reader.close
+      value
+    end
+
+    it 'should apply the PRAGMA options given in the URI' do
+      connection = DataObjects::Connection.new("#{CONFIG.uri}?synchronous=off&cache_size=-1024&temp_store=memory")
+      pragma(connection, 'synchronous').should == 0
+      pragma(connection, 'cache_size').should == -1024
+      pragma(connection, 'temp_store').should == 2
+      connection.close
+    end
+
+    it 'should raise an error for an invalid option value' do
+      lambda { DataObjects::Connection.new("#{CONFIG.uri}?journal_mode=wal;vacuum") }.
+        should raise_error(ArgumentError)
+    end
+
+    it 'should raise an error for a non numeric busy_timeout' do
+      lambda { DataObjects::Connection.new("#{CONFIG.uri}?busy_timeout=soon") }.
+        should raise_error(ArgumentError)
+    end
+
+    describe 'with a busy_timeout' do
+
+      before do
+        @path = File.join(Dir.tmpdir, "do_sqlite3_busy_#{$$}.db")
+        @locker = DataObjects::Connection.new("sqlite3:#{@path}")
+        @locker.create_command("CREATE TABLE IF NOT EXISTS locked_rows (id INTEGER)").execute_non_query
+      end
+
+      after do
+        @locker.close
+        File.delete(@path) if File.exist?(@path)
+      end
+
+      it 'should retry while another connection holds a write lock' do
+        @locker.create_command("BEGIN EXCLUSIVE").execute_non_query
+        unlocker = Thread.new do
+          sleep 0.3
+          @locker.create_command("COMMIT").execute_non_query
+        end
+
+        connection = DataObjects::Connection.new("sqlite3:#{@path}?busy_timeout=5000")
+        begin
+          connection.create_command("INSERT INTO locked_rows (id) VALUES (1)").execute_non_query.affected_rows.should == 1
+        ensure
+          unlocker.join
+          connection.close
+        end
+      end
+
+    end
+
+  end unless JRUBY
+
+  describe 'bulk_insert' do
+
+    before do
+      @connection = DataObjects::Connection.new(CONFIG.uri)
+      @connection.create_command("DROP TABLE IF EXISTS bulk_rows").execute_non_query
+      @connection.create_command("CREATE TABLE bulk_rows (id INTEGER PRIMARY KEY, name VARCHAR(50), weight FLOAT, released DATE, flag BOOLEAN)").execute_non_query
+    end
+
+    after do
+      @connection.create_command("DROP TABLE IF EXISTS bulk_rows").execute_non_query
+      @connection.close
+    end
+
+    def count
+      reader = @connection.create_command("SELECT COUNT(*) FROM bulk_rows").execute_reader
+      reader.next!
+      value = reader.values.first
+      reader.close
+      value
+    end
+
+    it 'should insert all rows and return the affected rows and last row id' do
+      rows = (1..25).map { |i| [i, "name #{i}", i * 1.5, Date.new(2010, 1, i), i.even?] }
+      result = @connection.bulk_insert('bulk_rows', %w[id name weight released flag], rows, 10)
+      result.affected_rows.should == 25
+      result.insert_id.should == 25
+      count.should == 25
+    end
+
+    it 'should store values the same way as query parameters' do
+      @connection.bulk_insert('bulk_rows', [:id, :name, :released, :flag], [[1, "O'Reilly", Date.new(2010, 1, 2), true]])
+      reader = @connection.create_command("SELECT name, released, flag FROM bulk_rows").execute_reader
+      reader.next!
+      reader.values.should == ["O'Reilly", Date.new(2010, 1, 2), true]
+      reader.close
+    end
+
+    it 'should roll back the failing chunk and keep earlier chunks' do
+      rows = [[1, 'a'], [2, 'b'], [3, 'c'], [3, 'duplicate']]
+      lambda { @connection.bulk_insert('bulk_rows', %w[id name], rows, 2) }.
+        should raise_error(DataObjects::SQLError)
+      count.should == 2
+    end
+
+    it 'should raise an error for a row with the wrong number of values' do
+      lambda { @connection.bulk_insert('bulk_rows', %w[id name], [[1]]) }.
+        should raise_error(ArgumentError)
+      count.should == 0
+    end
+
+  end unless JRUBY
+
+  describe 'prewarm' do
+
+    it 'should open and warm up the given number of connections' do
+      DataObjects::Connection.prewarm("#{CONFIG.uri}?prewarm=ok", 2, :prepare => ['SELECT 1']).should == 2
+    end
+
+    it 'should raise an error when a warmup statement fails' do
+      lambda { DataObjects::Connection.prewarm("#{CONFIG.uri}?prewarm=failing", 2, :prepare => ['SELECT * FROM missing_table']) }.
+        should raise_error(DataObjects::SQLError)
+    end
+
+  end
 end
@@ -0,0 +1,80 @@
+# encoding: utf-8
+
+require File.expand_path(File.join(File.dirname(__FILE__), 'spec_helper'))
+
+describe DataObjects::Sqlite3::Extension do
+
+  before do
+    @connection = DataObjects::Connection.new(CONFIG.uri)
+    @extension  = @connection.extension
+  end
+
+  after do
+    @connection.close
+  end
+
+  def select_value(sql)
+    reader = @connection.create_command(sql).execute_reader
+    reader.next!
+    value = reader.values.first
+    reader.close
+    value
+  end
+
+  describe 'create_function' do
+
+    it 'should call the block for every invocation' do
+      @extension.create_function('double_it', 1, :deterministic => true) { |value| value * 2 }
+      select_value('SELECT double_it(21)').should == 42
+    end
+
+    it 'should accept any number of arguments with an arity of -1' do
+      @extension.create_function('joined', -1) { |*values| values.join('-') }
+      select_value("SELECT joined('a', 2, 3.5)").should == 'a-2-3.5'
+    end
+
+    it 'should raise a SQLError when the block raises' do
+      @extension.create_function('failing', 0) { raise 'failed' }
+      lambda { @connection.create_command('SELECT failing()').execute_non_query }.
+        should raise_error(DataObjects::SQLError, /failed/)
+    end
+
+    it 'should require either a block or a native function' do
+      lambda { @extension.create_function('nothing', 0) }.should raise_error(ArgumentError)
+    end
+
+  end
+
+  describe 'create_aggregate' do
+
+    class LongestString
+      def initialize
+        @longest = nil
+      end
+
+      def step(value)
+        @longest = value if @longest.nil? || value.length > @longest.length
+      end
+
+      def finalize
+        @longest
+      end
+    end
+
+    it 'should use a new handler instance for every group' do
+      @extension.create_aggregate('longest', 1, LongestString)
+      select_value("SELECT longest(name) FROM (SELECT 'a' AS name UNION SELECT 'abc' UNION SELECT 'ab')").should == 'abc'
+    end
+
+    it 'should finalize empty groups' do
+      @extension.create_aggregate('longest', 1, LongestString)
+      select_value("SELECT longest(name) FROM (SELECT 'a' AS name) WHERE 1 = 0").should be_nil
+    end
+
+    it 'should require both native step and final functions without a handler' do
+      lambda { @extension.create_aggregate('nothing', 1, :step => 0) }.should raise_error(ArgumentError)
+    end
+
+  end
+
+end
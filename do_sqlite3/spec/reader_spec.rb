@@ -6,3 +6,36 @@ require 'data_objects/spec/shared/reader_spec'
 describe DataObjects::Sqlite3::Reader do
   it_should_behave_like 'a Reader'
 end
+
+describe DataObjects::Sqlite3::Reader, 'with types inferred from the declared column types' do
+  before do
+    @connection = DataObjects::Connection.new(CONFIG.uri)
+    @connection.create_command('CREATE TABLE mismatched (data BLOB, amount DECIMAL(10,2), born_on DATE, active BOOLEAN)').execute_non_query
+  end
+
+  after do
+    @connection.create_command('DROP TABLE mismatched').execute_non_query
+    @connection.close
+  end
+
+  def row(*values)
+    @connection.create_command('INSERT INTO mismatched VALUES (?, ?, ?, ?)').execute_non_query(*values)
+    reader = @connection.create_command('SELECT data, amount, born_on, active FROM mismatched').execute_reader
+    reader.next!
+    reader.values
+  ensure
+    reader.close if reader
+  end
+
+  it 'should decode values stored as the declared type' do
+    data, amount, born_on, active = row(::Extlib::ByteArray.new("\x00\x01"), '12.5', '2008-02-14', 1)
+    data.should be_kind_of(::Extlib::ByteArray)
+    amount.should == BigDecimal('12.5')
+    born_on.should == Date.new(2008, 2, 14)
+    active.should == true
+  end
+
+  it 'should return other values as they are stored' do
+    row('some text', 'not a number', 'not a date', 'yes').should == [ 'some text', 'not a number', 'not a date', 'yes' ]
+  end
+end
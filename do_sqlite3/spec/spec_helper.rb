@@ -32,6 +32,8 @@ CONFIG.uri          = ENV["DO_SQLITE3_SPEC_URI"] || "#{CONFIG.scheme}:#{CONFIG.d
 CONFIG.driver       = 'sqlite3'
 CONFIG.jdbc_driver  = DataObjects::Sqlite3.const_get('JDBC_DRIVER') rescue nil
 CONFIG.jdbc_uri     = CONFIG.uri.sub(/sqlite3/,"jdbc:sqlite")
+# SQLite has no sleep, this keeps it busy for a second or so
+CONFIG.sleep        = "WITH RECURSIVE counter(n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM counter WHERE n < 5000000) SELECT count(*) FROM counter"
 
 module DataObjectsSpecHelpers
 
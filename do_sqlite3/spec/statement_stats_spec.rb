@@ -0,0 +1,82 @@
+# encoding: utf-8
+
+require File.expand_path(File.join(File.dirname(__FILE__), 'spec_helper'))
+
+describe DataObjects::Sqlite3::StatementStats do
+
+  before :all do
+    setup_test_environment
+  end
+
+  before do
+    DataObjects::Sqlite3::StatementStats.reset!
+  end
+
+  after do
+    @connection.close
+  end
+
+  describe 'with statement_stats enabled' do
+
+    before do
+      @connection = DataObjects::Connection.new("#{CONFIG.uri}?statement_stats=true")
+      @connection.create_command('CREATE TABLE IF NOT EXISTS stats_test (id INTEGER, name TEXT)').execute_non_query
+      @connection.create_command('INSERT INTO stats_test VALUES (?, ?)').execute_non_query(1, 'one')
+      @connection.create_command('INSERT INTO stats_test VALUES (?, ?)').execute_non_query(2, 'two')
+    end
+
+    it 'should aggregate executions per SQL text' do
+      DataObjects::Sqlite3::StatementStats['INSERT INTO stats_test VALUES (?, ?)'][:executions].should == 2
+    end
+
+    it 'should capture the counters of a reader when it is closed' do
+      reader = @connection.create_command('SELECT * FROM stats_test WHERE name = ? ORDER BY id').execute_reader('two')
+      reader.each { |row| }
+
+      stats = DataObjects::Sqlite3::StatementStats['SELECT * FROM stats_test WHERE name = ? ORDER BY id']
+      stats[:executions].should == 1
+      stats[:fullscan_step].should > 0
+      stats[:sort].should == 1
+    end
+
+    it 'should capture the counters of a reader that is garbage collected' do
+      sql = 'SELECT * FROM stats_test WHERE id > ?'
+      reader = @connection.create_command(sql).execute_reader(0)
+      reader.next!
+      statement = reader.instance_variable_get(:@reader)
+
+      DataObjects::Sqlite3::StatementStats.send(:finalizer, statement, sql).call
+      DataObjects::Sqlite3::StatementStats[sql][:executions].should == 1
+      reader.close
+      DataObjects::Sqlite3::StatementStats[sql][:executions].should == 1
+    end
+
+    it 'should only keep the most recently run statements' do
+      stats = DataObjects::Sqlite3::StatementStats
+      stats.record('SELECT 0', {})
+      (1..stats::MAX_STATEMENTS).each { |i| stats.record("SELECT #{i}", {}) }
+      stats['SELECT 0'].should be_nil
+      stats.to_hash.size.should == stats::MAX_STATEMENTS
+
+      stats.record('SELECT 1', {})
+      stats.record('SELECT 0', {})
+      stats['SELECT 1'][:executions].should == 2
+      stats['SELECT 2'].should be_nil
+    end
+
+  end
+
+  describe 'with statement_stats disabled' do
+
+    before do
+      @connection = DataObjects::Connection.new(CONFIG.uri)
+    end
+
+    it 'should not record anything' do
+      @connection.create_command('SELECT 1').execute_non_query
+      DataObjects::Sqlite3::StatementStats.to_hash.should be_empty
+    end
+
+  end
+
+end
@@ -8,4 +8,5 @@ require 'data_objects/spec/shared/typecast/bigdecimal_spec'
 
 describe 'DataObjects::Sqlite3 with BigDecimal' do
   it_should_behave_like 'supporting BigDecimal'
+  it_should_behave_like 'supporting BigDecimal autocasting'
 end
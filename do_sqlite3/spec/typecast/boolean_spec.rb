@@ -8,4 +8,5 @@ require 'data_objects/spec/shared/typecast/boolean_spec'
 
 describe 'DataObjects::Sqlite3 with Boolean' do
   it_should_behave_like 'supporting Boolean'
+  it_should_behave_like 'supporting Boolean autocasting'
 end
@@ -8,4 +8,5 @@ require 'data_objects/spec/shared/typecast/date_spec'
 
 describe 'DataObjects::Sqlite3 with Date' do
   it_should_behave_like 'supporting Date'
+  it_should_behave_like 'supporting Date autocasting'
 end